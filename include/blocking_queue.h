@@ -0,0 +1,68 @@
+// ** Blocking queue: multi-producer / multi-consumer FIFO used to hand results between threads
+// Consumers block until an item arrives or the queue is closed and drained
+// Producers of a bounded queue block while it is full, so a fast stage cannot run arbitrarily far ahead of a slow one
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+template <typename T>
+class BlockingQueue {
+public:
+  // a capacity of 0 leaves the queue unbounded
+  explicit BlockingQueue(size_t capacityParam = 0) : capacity(capacityParam) {}
+
+  // appends an item, waiting for room in a bounded queue, ignored once the queue is closed
+  void push(T item) {
+    {
+      unique_lock<mutex> lock(queueMutex);
+      spaceCondition.wait(lock, [this] { return capacity == 0 || items.size() < capacity || closed; });
+      if (closed) {
+        return;
+      }
+      items.push_back(move(item));
+    }
+    itemCondition.notify_one();
+  }
+
+  // waits for the next item, returns false once the queue is closed and empty
+  bool pop(T &item) {
+    unique_lock<mutex> lock(queueMutex);
+    itemCondition.wait(lock, [this] { return !items.empty() || closed; });
+    if (items.empty()) {
+      return false;
+    }
+    item = move(items.front());
+    items.pop_front();
+    lock.unlock();
+    spaceCondition.notify_one();
+    return true;
+  }
+
+  // no more items will be pushed, consumers drain the remaining items and then stop
+  void close() {
+    {
+      lock_guard<mutex> lock(queueMutex);
+      closed = true;
+    }
+    itemCondition.notify_all();
+    spaceCondition.notify_all();
+  }
+
+  size_t size() {
+    lock_guard<mutex> lock(queueMutex);
+    return items.size();
+  }
+
+private:
+  mutex queueMutex;
+  condition_variable itemCondition;
+  condition_variable spaceCondition;
+  deque<T> items;
+  size_t capacity;
+  bool closed = false;
+};
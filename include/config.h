@@ -4,10 +4,15 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 // similarity threshold value used to determine a match between vectors
 const double MATCH_THRESHOLD = 0.44;
 
+// similarity thresholds of the tiered scenario, ordered from the strictest to the most investigative tier
+// all tiers are compared against the same similarity scores and share one Chebyshev basis
+const std::vector<double> MATCH_TIERS = {0.50, 0.44, 0.38};
+
 // Depth to be consumed by the comparison approximation function
 // Relationship with multiplicative depth described at the below link
 // https://github.com/openfheorg/openfhe-development/blob/main/src/pke/examples/FUNCTION_EVALUATION.md
@@ -17,9 +22,91 @@ const size_t COMP_DEPTH = 10;
 // Invokes a mult depth of alpha in the group-testing approach
 const size_t ALPHA_DEPTH = 2;
 
+// Bits of modulus kept above the largest scaled value when response ciphertexts are mod-reduced
+// Absorbs decryption noise and the overshoot of the comparison approximation
+const size_t RESPONSE_MARGIN_BITS = 10;
+
+// Number of approximate-max rounds in the argmax tournament, spent first on folding result ciphers together
+// and then on rotations within slot blocks; the receiver scans one leader slot per block of the result
+const size_t ARGMAX_ROUNDS = 4;
+
+// Depth of the step approximation inside each approximate-max round (between 7 and 15)
+const size_t ARGMAX_STEP_DEPTH = 7;
+
+// Scores within this distance of their block maximum are flagged as the best match
+// Must clear both the overshoot of the approximate maximum and the ~0.05 transition width of the flag comparison
+const double ARGMAX_MARGIN = 0.1;
+
+// Number of matrices whose similarity is computed before their comparisons run in parallel in streamed index scenarios
+// Smaller waves emit the first results sooner, larger waves keep more threads busy during comparison
+const size_t STREAM_WAVE_MATRICES = 4;
+
+// Number of watchlists the database is split into by the multi-gallery scenario
+const size_t MULTI_GALLERY_COUNT = 4;
+
+// The incremental scenario deletes every this many vectors, from index 2 on, before compacting the gallery
+const size_t INCREMENTAL_DELETE_STRIDE = 7;
+
+// Number of gallery slots per identity block when comparison results are aggregated per identity
+// Identities with more templates span several blocks; must be a power of two
+const size_t IDENTITY_BLOCK_LEN = 64;
+
 // Number of threads used in multithreaded sections
 const size_t MAX_NUM_CORES = 48;
 
+// Number of queries the query scheduler evaluates concurrently, each given MAX_NUM_CORES / SCHEDULER_WORKERS threads
+const size_t SCHEDULER_WORKERS = 4;
+
+// Queries waiting for a scheduler worker beyond this number are rejected at admission
+const size_t SCHEDULER_MAX_QUEUED = 64;
+
+// Index queries arriving within this window are evaluated together, loading each gallery cipher once per batch
+// At most SCHEDULER_MAX_BATCH queries form a batch; a window of 0 disables micro-batching
+const size_t SCHEDULER_BATCH_WINDOW_MS = 0;
+const size_t SCHEDULER_MAX_BATCH = 8;
+
+// Query pipeline: workers and cores of the similarity stage, the comparison stage gets the remaining cores
+// At most PIPELINE_QUEUE_DEPTH queries wait in front of each stage
+const size_t PIPELINE_SIMILARITY_WORKERS = 1;
+const size_t PIPELINE_SIMILARITY_CORES = MAX_NUM_CORES / 2;
+const size_t PIPELINE_COMPARISON_WORKERS = 1;
+const size_t PIPELINE_QUEUE_DEPTH = 2;
+
+// Load generator: default run length, length of each reported interval and number of distinct pre-encrypted queries
+const double LOADGEN_DURATION_S = 60.0;
+const double LOADGEN_REPORT_INTERVAL_S = 10.0;
+const size_t LOADGEN_QUERY_POOL = 8;
+
+// Seconds into a scheduler run of the load generator at which a second gallery version is swapped in; 0 disables the swap
+const double LOADGEN_SWAP_AT_S = 0.0;
+
+// Interval at which the load generator checks outstanding open-loop queries for completion
+const size_t LOADGEN_POLL_MS = 1;
+
+// Number of probes evaluated concurrently by the "all" mode of the accuracy experiment
+// Each probe is given MAX_NUM_CORES / ACCURACY_PARALLEL_PROBES threads
+const size_t ACCURACY_PARALLEL_PROBES = 8;
+
+// Number of evenly spaced thresholds in [-1, 1] swept when writing ROC / DET data
+const size_t ROC_THRESHOLD_STEPS = 400;
+
+// Encrypt gallery vectors under the secret key, storing only a seed for the uniform polynomial of each gallery file
+// Applies when the enroller holds the secret key, roughly halving gallery size; changes the serial/ format
+const bool SEEDED_CIPHERTEXTS = false;
+
+// Mask the scores of deleted gallery vectors before comparison (HERS, diagonal and HERS-Compact approaches)
+// Deletion then only writes a tombstone, at the cost of one multiplicative level; otherwise deleted slots are re-encrypted as zero
+const bool TOMBSTONE_MASKING = false;
+
+// Number of queries' worth of encryptions of zero kept ready by the receiver's background refill thread
+// Online query encryption is then reduced to encoding plus an addition; 0 encrypts every query in full
+// Refilling stops once the query is encrypted, so it does not compete with the timed sender phases
+const size_t ENCRYPTION_POOL_QUERIES = 0;
+
+// Record per-thread spans of every multiply, rotation, reduction, comparison and ciphertext load
+// Written per query as a Chrome / Perfetto trace JSON file prefixed with TRACE_PREFIX
+const bool ENABLE_TRACING = false;
+
 
 // ---------- Variables below should not be changed ----------
 
@@ -33,4 +120,28 @@ const size_t VECTOR_DIM = 512;
 // Must equal a power of 2
 const size_t CHUNK_LEN = 128;
 
-const std::string EXP_FILEPATH = "latency.csv";
\ No newline at end of file
+const std::string EXP_FILEPATH = "latency.csv";
+
+// Directory holding the serialized context, keys and gallery, each shard of a sharded gallery has its own below it
+const std::string SERIAL_ROOT = "serial/";
+
+const std::string TRACE_PREFIX = "trace_";
+
+// Deleted database indices of an incrementally maintained gallery, stored in its db_hers/ or db_diagonal/ directory
+const std::string TOMBSTONE_FILENAME = "tombstones.txt";
+
+// Enrollment epoch of each matrix of a gallery, one per line, stored next to its tombstones
+const std::string EPOCH_FILENAME = "epochs.txt";
+
+// Gallery ciphers written by serializeDB together with their checksums, read back to resume an interrupted enrollment
+const std::string MANIFEST_FILENAME = "manifest.txt";
+
+const std::string MEMORY_FILEPATH = "memory.csv";
+
+const std::string ROC_FILEPATH = "roc.csv";
+
+const std::string BENCH_FILEPATH = "wrapper_bench.csv";
+
+const std::string SHARD_FILEPATH = "shard.csv";
+
+const std::string LOADGEN_FILEPATH = "loadgen.csv";
\ No newline at end of file
@@ -0,0 +1,78 @@
+// ** Encryption pool: keeps encryptions of zero ready for the receiver, refilled by a background thread
+// Online encryption of a query cipher is then reduced to encoding the plaintext and one addition
+
+#pragma once
+
+#include "config.h"
+#include "openFHE_wrapper.h"
+#include "openfhe.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace lbcrypto;
+
+class EncryptionPool {
+public:
+  // counters describing how well the pool keeps up with the online encryptions
+  struct Metrics {
+    size_t depth;       // encryptions of zero currently held
+    size_t capacity;
+    size_t hits;        // online encryptions served from the pool
+    size_t misses;      // online encryptions performed in full because the pool was empty
+    size_t refilled;    // encryptions of zero produced by the refill thread
+    double refillRate;  // encryptions of zero produced per second spent refilling
+  };
+
+  // constructor -- the refill thread starts immediately and fills the pool up to capacity
+  EncryptionPool(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t capacityParam);
+
+  // destructor -- stops and joins the refill thread
+  ~EncryptionPool();
+
+  EncryptionPool(const EncryptionPool &) = delete;
+  EncryptionPool &operator=(const EncryptionPool &) = delete;
+
+  // encrypts values by adding their encoding to a pooled encryption of zero, encrypting in full if none is ready
+  // safe to call from several threads at once
+  Ciphertext<DCRTPoly> encrypt(vector<double> &values);
+
+  // blocks until the pool holds its full capacity
+  void waitUntilFull();
+
+  // stops and joins the refill thread, so that no refill competes with timed work; pooled ciphers stay usable
+  void stopRefill();
+
+  Metrics metrics();
+
+private:
+  // produces one public-key encryption of zero
+  Ciphertext<DCRTPoly> encryptZero();
+
+  Ciphertext<DCRTPoly> encryptFull(vector<double> &values);
+
+  void refillLoop();
+
+  CryptoContext<DCRTPoly> cc;
+  PublicKey<DCRTPoly> pk;
+  size_t capacity;
+
+  mutex poolMutex;
+  condition_variable refillCondition;  // signalled when the pool drops below capacity or is stopped
+  condition_variable fullCondition;    // signalled when the pool reaches capacity
+  deque<Ciphertext<DCRTPoly>> zeroCipher;
+  bool stopping;
+  size_t activeEncryptions;  // online encryptions in progress, during which refilling pauses
+
+  atomic<size_t> hits;
+  atomic<size_t> misses;
+  size_t refilled;
+  chrono::duration<double> refillTime;
+
+  thread refillThread;
+};
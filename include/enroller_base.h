@@ -8,7 +8,8 @@
 class BaseEnroller : public HersEnroller {
 public:
   // constructor
-  BaseEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam);
+  BaseEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam,
+               PrivateKey<DCRTPoly> skParam = nullptr);
 
   // public methods
   void serializeDB(vector<vector<double>> &database);
@@ -8,7 +8,8 @@
 class BlindEnroller : public HersEnroller {
 public:
   // constructor
-  BlindEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam);
+  BlindEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam,
+                PrivateKey<DCRTPoly> skParam = nullptr);
 
   // public methods
   void serializeDB(vector<vector<double>> &database, size_t chunkLength);
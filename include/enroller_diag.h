@@ -8,7 +8,8 @@
 class DiagonalEnroller : public HersEnroller {
 public:
   // constructor
-  DiagonalEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam);
+  DiagonalEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam,
+                   PrivateKey<DCRTPoly> skParam = nullptr);
 
   // public methods
   void serializeDB(vector<vector<double>> &database);
@@ -25,4 +26,11 @@ protected:
 
   void serializeDBThread(vector<double> &currentRows, size_t index);
 
+  // a database vector is one row of a square matrix, so its dimensions lie on VECTOR_DIM different diagonals
+  string galleryDirectory() override;
+
+  string cipherFilepath(size_t matrix, size_t index) override;
+
+  size_t cipherIndexOf(size_t vectorIndex, size_t dimension) override;
+
 };
\ No newline at end of file
@@ -4,11 +4,15 @@
 #pragma once
 
 #include "../include/config.h"
+#include "../include/enrollment_manifest.h"
+#include "../include/memory_utils.h"
 #include "../include/openFHE_wrapper.h"
 #include "../include/vector_utils.h"
 #include "openfhe.h"
 #include <vector>
 #include <filesystem>
+#include <map>
+#include <set>
 
 using namespace lbcrypto;
 using namespace std;
@@ -16,22 +20,92 @@ using namespace std;
 class HersEnroller {
 public:
   // constructor
-  HersEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam);
+  // gallery ciphers are stored seeded when the enroller is given the secret key
+  HersEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam,
+               PrivateKey<DCRTPoly> skParam = nullptr);
+
+  // destructor
+  virtual ~HersEnroller() = default;
 
   // public methods
   vector<vector<Ciphertext<DCRTPoly>>> encryptDB(vector<vector<double>> &database);
 
+  // resumable -- ciphers recorded in the manifest of an interrupted run with the same database and keys are kept
   void serializeDB(vector<vector<double>> &database);
 
+  // directory the gallery is serialized into, SERIAL_ROOT by default
+  void setSerialRoot(const string &root);
+
+  // incremental maintenance of a serialized gallery, for the HERS and diagonal layouts
+  // affected ciphers are decrypted, changed and re-encrypted, so these require the secret key (except deletion with TOMBSTONE_MASKING)
+  // each changed matrix costs VECTOR_DIM cipher rewrites, however many of its vectors change
+
+  // enrolls vectors into the free slots of the last matrix, then into new matrices
+  // returns the database index given to each vector
+  vector<size_t> appendVectors(vector<vector<double>> &vectors);
+
+  // replaces the vectors at the given database indices, reviving deleted ones
+  void updateVectors(const vector<size_t> &indices, vector<vector<double>> &vectors);
+
+  // records the given database indices in the gallery's tombstone list
+  // their scores are masked by the sender with TOMBSTONE_MASKING, and their slots are zeroed here otherwise
+  void deleteVectors(const vector<size_t> &indices);
+
+  // moves the last live vectors into deleted slots and removes the matrices left empty
+  // returns the new database index of every moved vector
+  map<size_t, size_t> compactGallery();
+
+  // number of database slots, including deleted ones until the gallery is compacted
+  size_t vectorCount();
+
+  // every matrix is tagged with the epoch it was last enrolled into: 0 for serializeDB,
+  // and a new epoch for each call of appendVectors or updateVectors that changes it
+  size_t latestEpoch();
 
 protected:
   // private members
   CryptoContext<DCRTPoly> cc;
   PublicKey<DCRTPoly> pk;
+  PrivateKey<DCRTPoly> sk;
   size_t numVectors;
+  string serialRoot;
 
   // private functions
   Ciphertext<DCRTPoly> encryptDBThread(size_t matrix, size_t index, vector<vector<double>> &database);
 
   void serializeDBThread(size_t matrix, size_t index, vector<vector<double>> &database);
+
+  void serializeCipher(vector<double> &values, const string &filepath);
+
+  // gallery layout, overridden by enrollers writing the same vectors in another arrangement
+  // the slot of a vector is always its database index modulo the batch size
+  virtual string galleryDirectory();
+
+  virtual string cipherFilepath(size_t matrix, size_t index);
+
+  // index of the cipher holding the given dimension of a vector within its matrix
+  virtual size_t cipherIndexOf(size_t vectorIndex, size_t dimension);
+
+  // writes whole vectors into their slots, decrypting and re-encrypting each affected cipher once
+  void rewriteSlots(const map<size_t, vector<double>> &vectors);
+
+  void rewriteCipher(const string &filepath, const vector<pair<size_t, double>> &slotValues);
+
+  // decrypts the given vectors from the serialized gallery
+  map<size_t, vector<double>> readSlots(const set<size_t> &indices);
+
+  // epoch of each matrix, galleries enrolled before epochs were recorded are in epoch 0
+  vector<size_t> readEpochs();
+
+  void writeEpochs(const vector<size_t> &epochs);
+
+  // tags the matrices holding the given vectors with a new epoch
+  void tagEpoch(const map<size_t, vector<double>> &vectors);
+
+  // state of a freshly serialized gallery of numMatrices matrices: no tombstones, every matrix in epoch 0,
+  // and no ciphers left over from an earlier, larger gallery in the same directory
+  void resetGallery(size_t numMatrices);
+
+  // removes the ciphers of matrices first to end - 1, along with their directory once empty
+  void removeMatrices(size_t first, size_t end);
 };
\ No newline at end of file
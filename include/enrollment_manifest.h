@@ -0,0 +1,60 @@
+// ** Enrollment manifest: records which gallery ciphers of an enrollment run were written completely
+// Lets an interrupted enrollment resume, skipping every cipher whose file still matches its recorded checksum
+
+#pragma once
+
+#include "config.h"
+#include "openfhe.h"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace lbcrypto;
+
+class EnrollmentManifest {
+public:
+  // constructor -- manifest of the numUnits gallery ciphers below dirpath
+  // units recorded by an earlier run are only reused if that run enrolled the same gallery fingerprint
+  EnrollmentManifest(const string &dirpath, size_t numUnits, uint64_t fingerprint);
+
+  // identifies a gallery by its plaintext vectors and the public key they are encrypted under,
+  // so that regenerated keys or another database start the enrollment over
+  static uint64_t fingerprint(PublicKey<DCRTPoly> pk, const vector<vector<double>> &database);
+
+  // whether the cipher at filepath was written by an earlier run and its file is unchanged
+  // safe to call from several threads at once
+  bool finished(const string &filepath);
+
+  // records the cipher just written to filepath, together with the checksum of its file
+  // safe to call from several threads at once
+  void markFinished(const string &filepath);
+
+  // replaces the manifest file with the units finished so far and prints progress and throughput
+  void checkpoint();
+
+private:
+  // FNV-1a hash of a file's contents, returns false if it cannot be read
+  static bool checksum(const string &filepath, uint64_t &hash);
+
+  string unitName(const string &filepath);
+
+  string dirpath;
+  string manifestPath;
+  size_t numUnits;
+  uint64_t galleryFingerprint;
+
+  // units of the earlier run, read once by the constructor
+  map<string, uint64_t> recordedUnits;
+
+  mutex unitMutex;
+  map<string, uint64_t> finishedUnits;
+  size_t verifiedCount;
+  size_t writtenCount;
+  chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,71 @@
+// ** Gallery manager: serves queries from the current enrolled gallery while the next version is loaded in the background
+// Versions are double buffered: a staged version replaces the current one atomically once it is loaded,
+// and queries that already hold the previous version finish on it
+
+#pragma once
+
+#include "config.h"
+#include "sender.h"
+#include "openfhe.h"
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace lbcrypto;
+
+class GalleryManager {
+public:
+  // builds the sender of the approach being served, its serial root is set by the manager
+  typedef function<Sender *(CryptoContext<DCRTPoly>, PublicKey<DCRTPoly>, size_t)> SenderFactory;
+
+  // constructor -- serves the gallery enrolled below root, e.g. SERIAL_ROOT or versionRoot(0)
+  GalleryManager(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, SenderFactory factoryParam,
+                 const string &root, size_t numVectors);
+
+  // destructor -- waits for a staged version still loading
+  ~GalleryManager();
+
+  GalleryManager(const GalleryManager &) = delete;
+  GalleryManager &operator=(const GalleryManager &) = delete;
+
+  // directory of a versioned gallery below SERIAL_ROOT, to be passed to an enroller's setSerialRoot
+  static string versionRoot(size_t version);
+
+  // sender of the current version, to be held for the whole query
+  // safe to call from several threads at once
+  shared_ptr<Sender> acquire();
+
+  // number of swaps since construction, 0 while the initial gallery is served
+  size_t version();
+
+  // starts loading the gallery enrolled below root in the background and swaps it in once loaded
+  // returns false if another version is still loading
+  // stage and waitForSwap are meant to be called from a single control thread
+  bool stage(const string &root, size_t numVectors);
+
+  // blocks until the staged version is swapped in or discarded, returns whether it was swapped in
+  bool waitForSwap();
+
+private:
+  // reads every gallery file once, so the first queries on the new version do not wait for the disk
+  // returns false if the directory holds no gallery
+  bool warmGallery(const string &root, size_t &fileCount, uintmax_t &byteCount);
+
+  void loadVersion(string root, size_t numVectors);
+
+  CryptoContext<DCRTPoly> cc;
+  PublicKey<DCRTPoly> pk;
+  SenderFactory factory;
+
+  mutex currentMutex;
+  shared_ptr<Sender> current;
+  size_t currentVersion;
+
+  thread loader;
+  atomic<bool> loading;
+  bool lastSwapped;
+};
@@ -0,0 +1,83 @@
+// ** Memory accounting utilities: tracks live ciphertext / plaintext bytes and key-material size,
+// and samples resident set size (current and peak) at phase boundaries
+
+#pragma once
+
+#include "config.h"
+#include "openfhe.h"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace lbcrypto;
+
+namespace MemoryUtils {
+
+enum MemoryKind { CIPHERTEXT_MEMORY, PLAINTEXT_MEMORY };
+
+// snapshot of all tracked quantities taken at a phase boundary
+struct PhaseSample {
+  string phase;
+  size_t liveCipherBytes;
+  size_t peakCipherBytes;
+  size_t livePlaintextBytes;
+  size_t peakPlaintextBytes;
+  size_t keyBytes;
+  size_t residentBytes;
+  size_t peakResidentBytes;
+};
+
+// in-memory size of the RNS polynomials held by ciphertexts / plaintexts / keys
+size_t polyBytes(const DCRTPoly &poly);
+
+size_t cipherBytes(const Ciphertext<DCRTPoly> &ctxt);
+
+size_t cipherBytes(const vector<Ciphertext<DCRTPoly>> &ctxts);
+
+size_t plaintextBytes(const Plaintext &ptxt);
+
+size_t templateBytes(const vector<vector<double>> &vectors);
+
+// total size of every relinearization, rotation and summation key held by OpenFHE
+size_t keyMaterialBytes();
+
+// live byte counters, updated through ScopedLiveBytes
+void addLiveBytes(MemoryKind kind, size_t bytes);
+
+void releaseLiveBytes(MemoryKind kind, size_t bytes);
+
+// current and peak (high-water mark) resident set size of this process, read from /proc/self/status
+size_t residentBytes();
+
+size_t peakResidentBytes();
+
+// records a snapshot of the counters and RSS under the given phase name
+PhaseSample samplePhase(const string &phase);
+
+// returns and clears all samples taken since the last call
+vector<PhaseSample> takeSamples();
+
+// appends the samples as rows of a .csv file, each row prefixed with the given label columns
+void writeSamples(const string &filepath, const string &label, const vector<PhaseSample> &samples);
+
+// RAII guard adding a number of bytes to a live counter for the lifetime of the enclosing scope
+class ScopedLiveBytes {
+public:
+  ScopedLiveBytes(MemoryKind kindParam, size_t bytesParam);
+  ~ScopedLiveBytes();
+
+  void add(size_t extraBytes);
+
+  ScopedLiveBytes(const ScopedLiveBytes &) = delete;
+  ScopedLiveBytes &operator=(const ScopedLiveBytes &) = delete;
+
+private:
+  MemoryKind kind;
+  size_t bytes;
+};
+
+} // namespace MemoryUtils
@@ -3,6 +3,9 @@
 #pragma once
 
 #include "config.h"
+#include "thread_budget.h"
+#include "trace_utils.h"
+#include "vector_utils.h"
 #include "openfhe.h"
 
 using namespace std;
@@ -10,9 +13,39 @@ using namespace lbcrypto;
 
 namespace OpenFHEWrapper {
 
+// seed from which the uniform polynomial of a seeded ciphertext is regenerated
+typedef array<uint32_t, 16> CipherSeed;
+
 size_t 
 computeRequiredDepth(size_t approach);
 
+size_t
+computeScoreDepth(size_t approach);
+
+size_t
+computeIdentityDepth();
+
+size_t
+computeArgmaxDepth();
+
+size_t
+computeTieredDepth();
+
+size_t
+argmaxBlockLength(size_t numCiphers);
+
+vector<size_t>
+decodeArgmax(const vector<double> &argmaxValues, size_t batchSize, size_t numVectors);
+
+vector<double>
+simulateCompare(const vector<double> &values, double delta, size_t signDepth, double lower = -1.0, double upper = 1.0);
+
+vector<double>
+simulateMax(const vector<double> &a, const vector<double> &b, size_t signDepth);
+
+vector<double>
+simulateArgmax(const vector<double> &scores, size_t batchSize);
+
 void 
 printSchemeDetails(CCParams<CryptoContextCKKSRNS> parameters, CryptoContext<DCRTPoly> cc);
 
@@ -28,6 +61,9 @@ decryptToVector(CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk, Ciphertext<
 vector<double> 
 decryptVectorToVector(CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk, vector<Ciphertext<DCRTPoly>> ctxt);
 
+vector<size_t>
+decryptThresholdIndices(CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk, vector<Ciphertext<DCRTPoly>> &ctxt, double threshold);
+
 Ciphertext<DCRTPoly> 
 binaryRotate(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt, int factor);
 
@@ -38,7 +74,17 @@ Ciphertext<DCRTPoly>
 sumAllSlots(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt);
 
 Ciphertext<DCRTPoly>
-chebyshevCompare(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt, double delta, size_t signDepth);
+chebyshevCompare(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt, double delta, size_t signDepth,
+                 double lower = -1.0, double upper = 1.0);
+
+vector<Ciphertext<DCRTPoly>>
+chebyshevCompareMulti(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt, const vector<double> &deltas, size_t signDepth);
+
+Ciphertext<DCRTPoly>
+chebyshevProduct(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> &ta, Ciphertext<DCRTPoly> &tb, Ciphertext<DCRTPoly> tdiff);
+
+Ciphertext<DCRTPoly>
+approxMax(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> a, Ciphertext<DCRTPoly> b, size_t signDepth);
 
 vector<Ciphertext<DCRTPoly>> 
 mergeCiphers(CryptoContext<DCRTPoly> cc, vector<Ciphertext<DCRTPoly>> &ctxts, size_t dimension);
@@ -51,4 +97,34 @@ generateMergeMask(CryptoContext<DCRTPoly> cc, size_t dimension, size_t segmentLe
 
 vector<Ciphertext<DCRTPoly>>
 compressCiphers(CryptoContext<DCRTPoly> cc, vector<Ciphertext<DCRTPoly>> &ctxts, size_t dimension);
+
+void
+finalizeResponse(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> &ctxt, double maxValue);
+
+size_t
+serializedBytes(Ciphertext<DCRTPoly> ctxt);
+
+size_t
+serializedBytes(vector<Ciphertext<DCRTPoly>> &ctxts);
+
+DCRTPoly
+seededUniform(shared_ptr<DCRTPoly::Params> params, const CipherSeed &seed);
+
+Ciphertext<DCRTPoly>
+encryptSeeded(CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk, vector<double> vec, CipherSeed &seed);
+
+void
+writeSeeded(ostream &stream, Ciphertext<DCRTPoly> ctxt, const CipherSeed &seed);
+
+bool
+serializeSeededToFile(const string &filepath, Ciphertext<DCRTPoly> ctxt, const CipherSeed &seed);
+
+bool
+deserializeCipherFromFile(CryptoContext<DCRTPoly> cc, const string &filepath, Ciphertext<DCRTPoly> &ctxt);
+
+bool
+serializeContext(CryptoContext<DCRTPoly> cc, PublicKey<DCRTPoly> pk, const string &dirpath);
+
+bool
+deserializeContext(CryptoContext<DCRTPoly> &cc, PublicKey<DCRTPoly> &pk, const string &dirpath);
 }
\ No newline at end of file
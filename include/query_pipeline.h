@@ -0,0 +1,77 @@
+// ** Query pipeline: evaluates index queries in two stages with separate worker pools connected by queues
+// Similarity (gallery loads and products) of one query overlaps the comparison of the previous one
+
+#pragma once
+
+#include "blocking_queue.h"
+#include "config.h"
+#include "sender.h"
+#include "thread_budget.h"
+#include "openfhe.h"
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace lbcrypto;
+
+class QueryPipeline {
+public:
+  struct Metrics {
+    size_t submitted;
+    size_t completed;
+    double similarityBusy;  // seconds spent in the similarity stage, summed over its workers
+    double comparisonBusy;  // seconds spent in the comparison stage, summed over its workers
+    double meanLatency;     // seconds from submission to index result
+  };
+
+  // constructor -- the sender must outlive the pipeline and is shared by both stages
+  // each stage splits its cores between its workers
+  QueryPipeline(Sender *senderParam, size_t similarityWorkersParam, size_t similarityCoresParam,
+                size_t comparisonWorkersParam, size_t comparisonCoresParam);
+
+  // constructor with the PIPELINE_* defaults of config.h
+  explicit QueryPipeline(Sender *senderParam);
+
+  // destructor -- finishes the queries already submitted and joins the workers
+  ~QueryPipeline();
+
+  QueryPipeline(const QueryPipeline &) = delete;
+  QueryPipeline &operator=(const QueryPipeline &) = delete;
+
+  // queues an index query, the result equals sender->indexScenario(queryCipher)
+  // blocks while the similarity stage is PIPELINE_QUEUE_DEPTH queries behind, safe to call from several threads at once
+  future<vector<Ciphertext<DCRTPoly>>> submit(vector<Ciphertext<DCRTPoly>> &queryCipher);
+
+  Metrics metrics();
+
+private:
+  struct Job {
+    vector<Ciphertext<DCRTPoly>> queryCipher;
+    vector<Ciphertext<DCRTPoly>> scoreCipher;
+    chrono::steady_clock::time_point submitted;
+    promise<vector<Ciphertext<DCRTPoly>>> result;
+  };
+
+  void similarityLoop(size_t cores);
+
+  void comparisonLoop(size_t cores);
+
+  Sender *sender;
+
+  BlockingQueue<shared_ptr<Job>> similarityQueue;
+  BlockingQueue<shared_ptr<Job>> comparisonQueue;
+
+  mutex metricsMutex;
+  size_t submitted;
+  size_t completed;
+  chrono::duration<double> similarityBusy;
+  chrono::duration<double> comparisonBusy;
+  chrono::duration<double> latency;
+
+  vector<thread> similarityWorkers;
+  vector<thread> comparisonWorkers;
+};
@@ -0,0 +1,130 @@
+// ** Query scheduler: admits concurrent queries in front of a sender and evaluates them on a fixed set of workers
+// Each worker is given its share of MAX_NUM_CORES, so concurrent queries no longer oversubscribe each other
+
+#pragma once
+
+#include "config.h"
+#include "gallery_manager.h"
+#include "sender.h"
+#include "thread_budget.h"
+#include "openfhe.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace lbcrypto;
+
+class QueryScheduler {
+public:
+  enum Policy { FIFO, EARLIEST_DEADLINE };
+
+  // scenarios the scheduler can evaluate, both answered with a vector of result ciphers
+  // membership results hold a single cipher, neither is finalized
+  enum Scenario { MEMBERSHIP, INDEX };
+
+  typedef chrono::steady_clock::time_point Deadline;
+
+  struct Options {
+    size_t workers = SCHEDULER_WORKERS;
+    size_t maxQueued = SCHEDULER_MAX_QUEUED;
+    Policy policy = FIFO;
+    chrono::milliseconds batchWindow = chrono::milliseconds(SCHEDULER_BATCH_WINDOW_MS);
+    size_t maxBatch = SCHEDULER_MAX_BATCH;
+  };
+
+  struct Metrics {
+    size_t admitted;
+    size_t rejected;         // refused at admission, because the queue was full or the deadline could not be met
+    size_t completed;
+    size_t missedDeadlines;  // completed after their deadline
+    size_t batches;          // evaluations started by the workers, one per query unless micro-batched
+    double meanWait;         // seconds between admission and the start of evaluation
+    double meanService;      // seconds of evaluation per batch
+  };
+
+  // queries without a deadline are admitted whenever the queue has room and are served last under EARLIEST_DEADLINE
+  static const Deadline NO_DEADLINE;
+
+  // constructor -- the sender must outlive the scheduler and is shared by all workers
+  QueryScheduler(Sender *senderParam, Options optionsParam);
+
+  // constructor with the SCHEDULER_* defaults of config.h
+  explicit QueryScheduler(Sender *senderParam);
+
+  // constructor serving the current gallery version of a gallery manager, which must outlive the scheduler
+  // each batch holds the version it started on, so a swap never affects queries already being evaluated
+  QueryScheduler(GalleryManager *galleriesParam, Options optionsParam);
+
+  // destructor -- evaluates the queries still queued and joins the workers
+  ~QueryScheduler();
+
+  QueryScheduler(const QueryScheduler &) = delete;
+  QueryScheduler &operator=(const QueryScheduler &) = delete;
+
+  // admits a query, returning false without touching result if it is rejected
+  // safe to call from several threads at once
+  bool submit(vector<Ciphertext<DCRTPoly>> &queryCipher, Scenario scenario, Deadline deadline,
+              future<vector<Ciphertext<DCRTPoly>>> &result);
+
+  // runs task once no query is being evaluated, holding off new evaluations until it returns
+  // used for anything that modifies the shared CryptoContext or sender, e.g. loading keys or a new gallery
+  void exclusive(const function<void()> &task);
+
+  // number of threads given to each query
+  size_t coresPerQuery();
+
+  Metrics metrics();
+
+private:
+  struct Request {
+    vector<Ciphertext<DCRTPoly>> queryCipher;
+    Scenario scenario;
+    Deadline deadline;
+    size_t sequence;
+    chrono::steady_clock::time_point admitted;
+    promise<vector<Ciphertext<DCRTPoly>>> result;
+  };
+
+  // common constructor -- exactly one of sender and galleries is set before the workers start
+  QueryScheduler(Sender *senderParam, GalleryManager *galleriesParam, Options optionsParam);
+
+  // next request under the scheduling policy, from the requests of the given scenario if one is given
+  // must be called with queueMutex held and a non-empty queue
+  vector<Request>::iterator nextRequest(const Scenario *scenario);
+
+  void workerLoop();
+
+  void evaluate(vector<Request> &batch);
+
+  Sender *sender;
+  GalleryManager *galleries;
+  Options options;
+  size_t workerCores;
+
+  mutex queueMutex;
+  condition_variable queueCondition;
+  vector<Request> queue;
+  bool stopping;
+  size_t nextSequence;
+
+  // held shared while queries are evaluated and exclusively by exclusive()
+  // workers start no new evaluation while an exclusive task is waiting, so it cannot be starved under load
+  shared_mutex contextMutex;
+  size_t exclusiveWaiting;
+
+  size_t admitted;
+  size_t rejected;
+  size_t completed;
+  size_t missedDeadlines;
+  size_t batches;
+  chrono::duration<double> waitTime;
+  chrono::duration<double> serviceTime;
+
+  vector<thread> workers;
+};
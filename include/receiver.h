@@ -3,6 +3,8 @@
 #pragma once
 
 #include "../include/config.h"
+#include "../include/encryption_pool.h"
+#include "../include/memory_utils.h"
 #include "../include/openFHE_wrapper.h"
 #include "../include/vector_utils.h"
 #include "openfhe.h"
@@ -27,17 +29,59 @@ public:
   virtual vector<Ciphertext<DCRTPoly>> 
   encryptQuery(vector<double> query) = 0;
 
+  // number of ciphers produced by encryptQuery, used to size the encryption pool
+  virtual size_t 
+  queryCipherCount() = 0;
+
   virtual bool 
   decryptMembership(Ciphertext<DCRTPoly> &membershipCipher) = 0;
 
   virtual vector<size_t> 
   decryptIndex(vector<Ciphertext<DCRTPoly>> &indexCipher) = 0;
 
+  // matches within a single index result cipher, given its position among the result ciphers
+  virtual vector<size_t> 
+  decryptIndexCipher(Ciphertext<DCRTPoly> &indexCipher, size_t cipherIndex) = 0;
+
+  virtual vector<double> 
+  decryptScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) = 0;
+
+  virtual vector<size_t> 
+  decryptIndexSparse(vector<Ciphertext<DCRTPoly>> &sparseCipher) = 0;
+
+  virtual vector<size_t> 
+  decryptArgmax(Ciphertext<DCRTPoly> &argmaxCipher) = 0;
+
+  // index results thresholded locally from the decrypted output of the score scenario
+  vector<size_t>
+  decryptIndexFromScores(vector<Ciphertext<DCRTPoly>> &scoreCipher);
+
+  // identities with at least one matching template, from the packed block sums of the identity scenario
+  vector<size_t>
+  decryptIdentity(vector<Ciphertext<DCRTPoly>> &identityCipher, const vector<size_t> &blockIdentity);
+
+  // bytes needed to upload an encrypted query
+  size_t
+  queryBytes(vector<Ciphertext<DCRTPoly>> &queryCipher);
+
+  // starts precomputing encryptions of zero for the given number of queries, taken by all later query encryptions
+  void
+  startEncryptionPool(size_t numQueries);
+
+  // pool of encryptions of zero, nullptr if not started
+  EncryptionPool *
+  encryptionPool();
+
 protected:
+  // protected methods
+  Ciphertext<DCRTPoly>
+  encryptVector(vector<double> &values);
+
   // protected members (accessible by derived classes)
   CryptoContext<DCRTPoly> cc;
   PublicKey<DCRTPoly> pk;
   PrivateKey<DCRTPoly> sk;
   size_t numVectors;
+  unique_ptr<EncryptionPool> pool;
 
 };
\ No newline at end of file
@@ -14,6 +14,8 @@ public:
   // public methods
   vector<Ciphertext<DCRTPoly>> encryptQuery(vector<double> query) override;
 
+  size_t queryCipherCount() override;
+
 protected:
 
 };
\ No newline at end of file
@@ -14,9 +14,20 @@ public:
   vector<Ciphertext<DCRTPoly>> 
   encryptQuery(vector<double> query) override;
 
+  size_t 
+  queryCipherCount() override;
+
   vector<size_t> 
   decryptIndex(vector<Ciphertext<DCRTPoly>> &indexCipher) override;
 
+  vector<double> 
+  decryptScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) override;
+
+protected:
+  // protected methods
+  size_t 
+  indexOfPosition(size_t position) override;
+
 private:
   // private methods
   Ciphertext<DCRTPoly> 
@@ -0,0 +1,19 @@
+// ** receiver_compact: Defines the receiver class for HERS with server-side query expansion
+// Uploads the query as a single replicated ciphertext instead of VECTOR_DIM broadcast ciphertexts
+
+#pragma once
+
+#include "receiver_hers.h"
+
+class CompactReceiver : public HersReceiver {
+public:
+  // constructor
+  CompactReceiver(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam,
+              PrivateKey<DCRTPoly> skParam, size_t vectorParam);
+
+  // public methods
+  vector<Ciphertext<DCRTPoly>> encryptQuery(vector<double> query) override;
+
+  size_t queryCipherCount() override;
+  
+};
@@ -12,5 +12,7 @@ public:
 
   // public methods
   vector<Ciphertext<DCRTPoly>> encryptQuery(vector<double> query) override;
+
+  size_t queryCipherCount() override;
   
 };
\ No newline at end of file
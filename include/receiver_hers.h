@@ -14,12 +14,24 @@ public:
   // public methods
   vector<Ciphertext<DCRTPoly>> encryptQuery(vector<double> query) override;
 
+  size_t queryCipherCount() override;
+
   bool decryptMembership(Ciphertext<DCRTPoly> &membershipCipher) override;
 
   vector<size_t> decryptIndex(vector<Ciphertext<DCRTPoly>> &indexCipher) override;
 
+  vector<size_t> decryptIndexCipher(Ciphertext<DCRTPoly> &indexCipher, size_t cipherIndex) override;
+
+  vector<double> decryptScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) override;
+
+  vector<size_t> decryptIndexSparse(vector<Ciphertext<DCRTPoly>> &sparseCipher) override;
+
+  vector<size_t> decryptArgmax(Ciphertext<DCRTPoly> &argmaxCipher) override;
+
 protected:
   // protected functions
+  virtual size_t indexOfPosition(size_t position);
+
   Ciphertext<DCRTPoly> encryptQueryAlt(vector<double> query);
 
 private:
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "../include/config.h"
+#include "../include/memory_utils.h"
 #include "../include/openFHE_wrapper.h"
 #include "../include/vector_utils.h"
 #include "openfhe.h"
@@ -12,10 +13,14 @@
 #include <time.h>
 #include <ctime>
 #include <fstream>
+#include <functional>
 
 using namespace lbcrypto;
 using namespace std;
 
+// receives each result cipher of a streamed index scenario together with its position among the result ciphers
+typedef function<void(size_t, Ciphertext<DCRTPoly>)> IndexCallback;
+
 class Sender {
 public:
   // constructor
@@ -34,10 +39,80 @@ public:
   virtual vector<Ciphertext<DCRTPoly>>
   indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) = 0;
 
+  // comparison stage of the index scenario -- index results from the scores of computeSimilarity
+  // indexScenario(query) equals compareScores(computeSimilarity(query)), so the two stages may run on separate threads
+  virtual vector<Ciphertext<DCRTPoly>>
+  compareScores(vector<Ciphertext<DCRTPoly>> &scoreCipher);
+
+  // argmax scenario -- single cipher encoding the best-scoring database vector
+  virtual Ciphertext<DCRTPoly>
+  argmaxScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) = 0;
+
+  // streaming index scenario -- emits each index result cipher as soon as it is computed, possibly out of order
+  // the callback may be invoked from several threads at once
+  virtual void
+  indexScenarioStream(vector<Ciphertext<DCRTPoly>> &queryCipher, const IndexCallback &emit);
+
+  // batched index scenario -- index results of several queries evaluated together, one result vector per query
+  virtual vector<vector<Ciphertext<DCRTPoly>>>
+  indexScenarioBatch(vector<vector<Ciphertext<DCRTPoly>>> &queryBatch);
+
+  // score scenario -- raw similarity scores for receivers allowed to threshold them locally
+  virtual vector<Ciphertext<DCRTPoly>>
+  scoreScenario(vector<Ciphertext<DCRTPoly>> &queryCipher);
+
+  // identity scenario -- comparison results summed per identity block of a gallery enrolled by identity
+  vector<Ciphertext<DCRTPoly>>
+  identityScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t blockLength);
+
+  // tiered scenario -- index results for each of several thresholds, sharing one similarity computation and Chebyshev basis
+  // requires approaches whose index result is the comparison of their similarity scores (all but GROTE)
+  vector<vector<Ciphertext<DCRTPoly>>>
+  tieredScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, const vector<double> &thresholds);
+
+  // membership result of each tier, summed from the tiered index results
+  vector<Ciphertext<DCRTPoly>>
+  tieredMembership(vector<vector<Ciphertext<DCRTPoly>>> &tierCipher);
+
+  // sparse index scenario -- index result compressed into a fixed number of ciphertexts
+  virtual vector<Ciphertext<DCRTPoly>>
+  indexScenarioSparse(vector<Ciphertext<DCRTPoly>> &queryCipher);
+
+  // directory the gallery is read from, SERIAL_ROOT by default
+  void
+  setSerialRoot(const string &root);
+
+  // response finalization -- mod-reduces scenario results to their minimal modulus before they are returned
+  void
+  finalizeMembership(Ciphertext<DCRTPoly> &membershipCipher);
+
+  void
+  finalizeIndex(vector<Ciphertext<DCRTPoly>> &indexCipher);
+
+  void
+  finalizeIndex(Ciphertext<DCRTPoly> &indexCipher);
+
+  void
+  finalizeSparseIndex(vector<Ciphertext<DCRTPoly>> &sparseCipher);
+
+  void
+  finalizeScores(vector<Ciphertext<DCRTPoly>> &scoreCipher);
+
+  void
+  finalizeIdentity(vector<Ciphertext<DCRTPoly>> &identityCipher);
+
+  void
+  finalizeArgmax(Ciphertext<DCRTPoly> &argmaxCipher);
+
 protected:
+  // protected methods
+  vector<Ciphertext<DCRTPoly>>
+  sparsifyIndex(vector<Ciphertext<DCRTPoly>> &indexCipher);
+
   // protected members (accessible by derived classes)
   CryptoContext<DCRTPoly> cc;
   PublicKey<DCRTPoly> pk;
   size_t numVectors;
+  string serialRoot;
   vector<vector<Ciphertext<DCRTPoly>>> databaseCipher;
 };
\ No newline at end of file
@@ -17,6 +17,14 @@ public:
   vector<Ciphertext<DCRTPoly>>
   indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) override;
 
+  // the HERS wave loop assumes the HERS gallery layout, so results are emitted once the whole scenario completes
+  void
+  indexScenarioStream(vector<Ciphertext<DCRTPoly>> &queryCipher, const IndexCallback &emit) override;
+
+  // the shared gallery loads of HERS read the HERS layout as well, so batched queries are evaluated one after another
+  vector<vector<Ciphertext<DCRTPoly>>>
+  indexScenarioBatch(vector<vector<Ciphertext<DCRTPoly>>> &queryBatch) override;
+
 protected:
 
   void
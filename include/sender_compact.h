@@ -0,0 +1,25 @@
+// ** sender_compact: defines the sender class for HERS with server-side query expansion
+// Expands a single replicated query ciphertext into the VECTOR_DIM broadcast ciphertexts used by HERS
+
+#pragma once
+
+#include "sender_hers.h"
+
+class CompactSender : public HersSender {
+public:
+  // constructor
+  CompactSender(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t vectorParam);
+
+  // public methods
+  vector<Ciphertext<DCRTPoly>>
+  computeSimilarity(vector<Ciphertext<DCRTPoly>> &queryCipher) override;
+
+protected:
+  // protected methods
+  vector<Ciphertext<DCRTPoly>>
+  prepareQuery(vector<Ciphertext<DCRTPoly>> &queryCipher) override;
+
+  vector<Ciphertext<DCRTPoly>>
+  expandQuery(Ciphertext<DCRTPoly> &queryCipher);
+
+};
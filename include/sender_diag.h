@@ -17,10 +17,33 @@ public:
   vector<Ciphertext<DCRTPoly>> 
   indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) override;
 
+  using HersSender::membershipScenario;
+  using HersSender::indexScenario;
+
+protected:
+  // all VECTOR_DIM rotations of the batched query, generated with hoisted rotations
+  vector<Ciphertext<DCRTPoly>>
+  prepareQuery(vector<Ciphertext<DCRTPoly>> &queryCipher) override;
+
+  Ciphertext<DCRTPoly> 
+  computeSimilarityMatrix(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t matrix) override;
+
+  Ciphertext<DCRTPoly>
+  loadDatabaseCipher(size_t matrix, size_t index) override;
+
+  // diagonal index of a matrix of the gallery enrolled below root
+  Ciphertext<DCRTPoly>
+  loadDiagonalCipher(const string &root, size_t matrix, size_t index);
+
+  // products are summed before a single relinearization and rescale
+  Ciphertext<DCRTPoly>
+  combineProducts(vector<Ciphertext<DCRTPoly>> &productCipher) override;
+
+  string
+  galleryDirectory() override;
+
 private:
   // private methods
-  Ciphertext<DCRTPoly> 
-  computeSimilarityMatrix(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t matrix);
 
   Ciphertext<DCRTPoly> 
   computeSimilarityThread(Ciphertext<DCRTPoly> &queryCipher, size_t matrix, size_t index);
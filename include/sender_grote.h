@@ -14,4 +14,8 @@ public:
   vector<Ciphertext<DCRTPoly>>
   indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) override;
 
+  // group-testing comparison: row and column results of the score matrix
+  vector<Ciphertext<DCRTPoly>>
+  compareScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) override;
+
 };
\ No newline at end of file
@@ -20,6 +20,30 @@ public:
   vector<Ciphertext<DCRTPoly>>
   indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) override;
 
+  // delta scenarios -- only the matrices enrolled after sinceEpoch are evaluated, e.g. to re-check a stored probe
+  // matrices receives the matrix of each index result cipher, to be passed to the receiver's decryptIndexCipher
+  Ciphertext<DCRTPoly>
+  membershipScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t sinceEpoch);
+
+  vector<Ciphertext<DCRTPoly>>
+  indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t sinceEpoch, vector<size_t> &matrices);
+
+  // latest enrollment epoch of the gallery, to be kept as the sinceEpoch of the next delta query
+  size_t
+  latestEpoch();
+
+  // requires scores laid out in database order, as produced by the HERS and diagonal approaches
+  Ciphertext<DCRTPoly>
+  argmaxScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) override;
+
+  // emits the result cipher of each matrix, processing STREAM_WAVE_MATRICES matrices at a time
+  void
+  indexScenarioStream(vector<Ciphertext<DCRTPoly>> &queryCipher, const IndexCallback &emit) override;
+
+  // loads every gallery cipher once for the whole batch and multiplies it with each query
+  vector<vector<Ciphertext<DCRTPoly>>>
+  indexScenarioBatch(vector<vector<Ciphertext<DCRTPoly>>> &queryBatch) override;
+
   // Ciphertext<DCRTPoly>
   // membershipScenario(vector<Ciphertext<DCRTPoly>> queryCipher, size_t rowLength);
 
@@ -27,6 +51,36 @@ public:
   // indexScenario(vector<Ciphertext<DCRTPoly>> queryCipher, size_t rowLength);
 
 protected:
+  // query ciphers as consumed by computeSimilarityMatrix, computed once per query
+  virtual vector<Ciphertext<DCRTPoly>>
+  prepareQuery(vector<Ciphertext<DCRTPoly>> &queryCipher);
+
+  // similarity scores of a single matrix of database vectors
+  virtual Ciphertext<DCRTPoly>
+  computeSimilarityMatrix(vector<Ciphertext<DCRTPoly>> &preparedCipher, size_t matrix);
+
+  // gallery cipher multiplied with prepared query cipher index of the given matrix
+  virtual Ciphertext<DCRTPoly>
+  loadDatabaseCipher(size_t matrix, size_t index);
+
+  // similarity scores of a matrix from its VECTOR_DIM unrelinearized products
+  virtual Ciphertext<DCRTPoly>
+  combineProducts(vector<Ciphertext<DCRTPoly>> &productCipher);
+
+  // directory of the gallery layout below the serial root, holding its tombstone list
+  virtual string
+  galleryDirectory();
+
+  // zeroes the scores of deleted vectors of a matrix of the gallery enrolled below root, if TOMBSTONE_MASKING is set
+  // consumes one level, but only for matrices holding a deleted vector
+  void
+  maskTombstones(Ciphertext<DCRTPoly> &scoreCipher, const string &root, size_t matrix);
+
+  // epoch of each matrix of the gallery as tagged by the enroller, 0 for galleries enrolled without epochs
+  // covers every matrix listed by the enroller, which may be more or fewer than numVectors spans
+  vector<size_t>
+  readEpochs();
+
   // private functions
   Ciphertext<DCRTPoly> 
   computeSimilarityHelper(size_t matrixIndex, vector<Ciphertext<DCRTPoly>> &queryCipher);
@@ -40,6 +94,9 @@ protected:
   vector<Ciphertext<DCRTPoly>> 
   alphaNormRows(vector<Ciphertext<DCRTPoly>> &scoreCipher, size_t alpha, size_t rowLength);
 
+  Ciphertext<DCRTPoly>
+  argmaxTournament(vector<Ciphertext<DCRTPoly>> &scoreCipher, size_t blockLength);
+
   vector<Ciphertext<DCRTPoly>> 
   alphaNormColumns(vector<Ciphertext<DCRTPoly>> &scoreCipher, size_t alpha, size_t rowLength);
 };
\ No newline at end of file
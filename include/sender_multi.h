@@ -0,0 +1,43 @@
+// ** sender_multi: defines the sender class for the diagonal approach over several named galleries
+// One query is evaluated against a chosen subset of the galleries, sharing its hoisted rotations between them
+
+#pragma once
+
+#include "sender_diag.h"
+#include <map>
+
+class MultiGallerySender : public DiagonalSender {
+public:
+  // results of one gallery, laid out as those of the diagonal membership and index scenarios
+  struct GalleryResult {
+    Ciphertext<DCRTPoly> membershipCipher;
+    vector<Ciphertext<DCRTPoly>> indexCipher;
+  };
+
+  // constructor -- galleries are added with addGallery
+  MultiGallerySender(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam);
+
+  // registers a gallery enrolled by a DiagonalEnroller below root
+  void
+  addGallery(const string &name, const string &root, size_t galleryVectors);
+
+  vector<string>
+  galleryNames();
+
+  // membership and index results of each named gallery, computed from one set of query rotations
+  // unknown names are reported and skipped
+  map<string, GalleryResult>
+  multiGalleryScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, const vector<string> &names);
+
+private:
+  struct Gallery {
+    string root;
+    size_t numVectors;
+  };
+
+  // similarity scores of a single matrix of the gallery enrolled below root
+  Ciphertext<DCRTPoly>
+  computeGalleryMatrix(vector<Ciphertext<DCRTPoly>> &rotatedQueryCipher, const string &root, size_t matrix);
+
+  map<string, Gallery> galleries;
+};
\ No newline at end of file
@@ -0,0 +1,30 @@
+// ** Per-thread core budget: number of OpenMP threads a calling thread may use in its
+// multithreaded sections. Defaults to MAX_NUM_CORES.
+
+#pragma once
+
+#include "config.h"
+#include <cstddef>
+
+namespace ThreadBudget {
+
+// number of threads to request in the num_threads clause of parallel regions started by this thread
+size_t cores();
+
+// sets the budget of the calling thread (clamped to [1, MAX_NUM_CORES])
+void setCores(size_t numCores);
+
+// RAII guard that sets the budget of the calling thread and restores the previous value on exit
+class ScopedBudget {
+public:
+  explicit ScopedBudget(size_t numCores);
+  ~ScopedBudget();
+
+  ScopedBudget(const ScopedBudget &) = delete;
+  ScopedBudget &operator=(const ScopedBudget &) = delete;
+
+private:
+  size_t previousCores;
+};
+
+} // namespace ThreadBudget
@@ -0,0 +1,56 @@
+// ** Span tracing utilities: records per-thread begin/end events of homomorphic operations
+// and exports them as a Chrome / Perfetto trace (open with chrome://tracing or ui.perfetto.dev)
+
+#pragma once
+
+#include "config.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace TraceUtils {
+
+// single completed span, timestamps are relative to the start of the current query
+struct TraceEvent {
+  const char *name;
+  const char *category;
+  size_t threadID;
+  long long startMicros;
+  long long durationMicros;
+};
+
+// clears any recorded events and resets the trace origin to the current time
+void beginQuery();
+
+// records a completed span for the calling thread, no-op unless ENABLE_TRACING is set
+void recordSpan(const char *name, const char *category,
+                chrono::steady_clock::time_point start, chrono::steady_clock::time_point end);
+
+// writes all spans recorded since beginQuery() to a Chrome trace JSON file
+bool writeTrace(const string &filepath);
+
+// small, stable per-thread identifier used as the "tid" field of the trace
+size_t threadID();
+
+// RAII span: records [construction, destruction) of the enclosing scope when ENABLE_TRACING is set
+class ScopedSpan {
+public:
+  ScopedSpan(const char *nameParam, const char *categoryParam);
+  ~ScopedSpan();
+
+  ScopedSpan(const ScopedSpan &) = delete;
+  ScopedSpan &operator=(const ScopedSpan &) = delete;
+
+private:
+  const char *name;
+  const char *category;
+  chrono::steady_clock::time_point start;
+};
+
+} // namespace TraceUtils
@@ -1,4 +1,5 @@
 // ** Contains the functionalities for loading and processing of plaintext data vectors.
+// Inner products and threshold scans are computed by AVX-512 / AVX2 kernels selected at runtime, with scalar fallbacks.
 
 #pragma once
 
@@ -8,19 +9,67 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <map>
+#include <set>
 
 using namespace std;
 
 namespace VectorUtils {
 
-void concatenateVectors(vector<double> &dest, vector<double> source,
+void concatenateVectors(vector<double> &dest, const vector<double> &source,
                         int n);
 
-double plaintextCosineSim(vector<double> x, vector<double> y);
+double plaintextCosineSim(const vector<double> &x, const vector<double> &y);
 
-double plaintextMagnitude(vector<double> x, int vectorDim);
+double plaintextMagnitude(const vector<double> &x, int vectorDim);
 
-vector<double> plaintextNormalize(vector<double> x, int vectorDim);
+vector<double> plaintextNormalize(const vector<double> &x, int vectorDim);
 
-double plaintextInnerProduct(vector<double> x, vector<double> y, int vectorDim);
-} // namespace VectorUtils
\ No newline at end of file
+double plaintextInnerProduct(const vector<double> &x, const vector<double> &y, int vectorDim);
+
+// inner product of two contiguous arrays of length n using the dispatched SIMD kernel
+double innerProduct(const double *x, const double *y, size_t n);
+
+// appends (offset + i) for every values[i] >= threshold, in increasing order, using the dispatched SIMD kernel
+void thresholdIndices(const double *values, size_t n, double threshold, size_t offset, vector<size_t> &indices);
+
+vector<size_t> thresholdIndices(const vector<double> &values, double threshold);
+
+// name of the instruction set chosen by the runtime dispatch ("avx512", "avx2" or "scalar")
+string simdLevel();
+
+// copies vectors into a contiguous row-major matrix of vectorDim columns
+vector<double> flattenVectors(const vector<vector<double>> &vectors, size_t vectorDim);
+
+// normalizes every vector in place
+void plaintextNormalizeBatch(vector<vector<double>> &vectors, size_t vectorDim);
+
+void plaintextNormalizeBatch(vector<double> &matrix, size_t vectorDim);
+
+// cosine similarity of every query against every row of a contiguous matrix, indexed [query][row]
+// rows are processed in cache-sized blocks shared by all queries
+vector<vector<double>> plaintextCosineScores(const vector<vector<double>> &queries,
+                                             const vector<double> &matrix, size_t vectorDim);
+
+// gallery layout grouping the templates of each identity into blocks of blockLength consecutive positions
+struct IdentityLayout {
+  size_t blockLength;
+  vector<long> positionTemplate;   // template stored at each gallery position, -1 for padding
+  vector<size_t> blockIdentity;    // identity owning each block
+};
+
+IdentityLayout identityLayout(const vector<size_t> &identities, size_t blockLength);
+
+// reorders templates into the given layout, filling padding positions with zero vectors
+vector<vector<double>> applyIdentityLayout(const vector<vector<double>> &templates, const IdentityLayout &layout);
+
+// indices stored one per line, e.g. the tombstones or matrix epochs of a gallery; empty if the file does not exist
+vector<size_t> readIndexList(const string &filepath);
+
+set<size_t> readIndexSet(const string &filepath);
+
+// writes to a temporary file that is then renamed over filepath, so readers see either the old or the new list
+bool writeIndexList(const string &filepath, const vector<size_t> &indices);
+
+bool writeIndexSet(const string &filepath, const set<size_t> &indices);
+} // namespace VectorUtils
@@ -27,6 +27,11 @@ echo "Technique 5: HyDia (ours) approach"
 ./ImageMatching ../test/2_10.dat 5  # HyDia approach
 echo "Hydia (ours) approach test completed."
 
+echo ""
+echo "Technique 6: HERS approach with single-ciphertext query"
+./ImageMatching ../test/2_10.dat 6  # HERS with server-side query expansion
+echo "HERS compact-query approach test completed."
+
 # ./ImageMatchingAccuracy 0 5         # Accuracy experiment   
 
 echo ">>> Finished OK.  For full experiments run:"
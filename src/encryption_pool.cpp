@@ -0,0 +1,123 @@
+#include "../include/encryption_pool.h"
+
+// implementation of functions declared in encryption_pool.h
+
+// -------------------- CONSTRUCTOR --------------------
+
+EncryptionPool::EncryptionPool(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, size_t capacityParam)
+    : cc(ccParam), pk(pkParam), capacity(capacityParam), stopping(false), activeEncryptions(0),
+      hits(0), misses(0), refilled(0), refillTime(0.0) {
+  refillThread = thread(&EncryptionPool::refillLoop, this);
+}
+
+EncryptionPool::~EncryptionPool() {
+  stopRefill();
+}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+// an encryption of zero plus an encoded plaintext is a fresh encryption of that plaintext
+// each pooled cipher is handed out exactly once, so no two queries share encryption randomness
+Ciphertext<DCRTPoly> EncryptionPool::encrypt(vector<double> &values) {
+
+  Ciphertext<DCRTPoly> zero;
+  {
+    lock_guard<mutex> lock(poolMutex);
+    activeEncryptions++;
+    if (!zeroCipher.empty()) {
+      zero = zeroCipher.front();
+      zeroCipher.pop_front();
+    }
+  }
+
+  Ciphertext<DCRTPoly> result;
+  if (zero) {
+    hits++;
+    TraceUtils::ScopedSpan span("Encrypt (pooled)", "encrypt");
+    Plaintext ptxt = cc->MakeCKKSPackedPlaintext(values);
+    result = cc->EvalAdd(zero, ptxt);
+  } else {
+    misses++;
+    result = encryptFull(values);
+  }
+
+  // the refill thread only runs while no online encryption is in progress
+  {
+    lock_guard<mutex> lock(poolMutex);
+    activeEncryptions--;
+  }
+  refillCondition.notify_one();
+  return result;
+}
+
+
+void EncryptionPool::waitUntilFull() {
+  unique_lock<mutex> lock(poolMutex);
+  fullCondition.wait(lock, [this] { return zeroCipher.size() >= capacity || stopping; });
+}
+
+
+// a refill already under way is finished before the thread exits
+void EncryptionPool::stopRefill() {
+  {
+    lock_guard<mutex> lock(poolMutex);
+    stopping = true;
+  }
+  refillCondition.notify_all();
+  if (refillThread.joinable()) {
+    refillThread.join();
+  }
+}
+
+
+EncryptionPool::Metrics EncryptionPool::metrics() {
+  lock_guard<mutex> lock(poolMutex);
+  Metrics current;
+  current.depth = zeroCipher.size();
+  current.capacity = capacity;
+  current.hits = hits;
+  current.misses = misses;
+  current.refilled = refilled;
+  current.refillRate = (refillTime.count() > 0.0) ? double(refilled) / refillTime.count() : 0.0;
+  return current;
+}
+
+// -------------------- PRIVATE FUNCTIONS --------------------
+
+Ciphertext<DCRTPoly> EncryptionPool::encryptZero() {
+  vector<double> zeros(cc->GetEncodingParams()->GetBatchSize(), 0.0);
+  return encryptFull(zeros);
+}
+
+
+Ciphertext<DCRTPoly> EncryptionPool::encryptFull(vector<double> &values) {
+  return OpenFHEWrapper::encryptFromVector(cc, pk, values);
+}
+
+
+void EncryptionPool::refillLoop() {
+  unique_lock<mutex> lock(poolMutex);
+  while (true) {
+    refillCondition.wait(lock, [this] {
+      return stopping || (zeroCipher.size() < capacity && activeEncryptions == 0);
+    });
+    if (stopping) {
+      break;
+    }
+
+    // encrypt outside the lock so that online encryptions are never blocked by a refill
+    lock.unlock();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Ciphertext<DCRTPoly> zero = encryptZero();
+    chrono::duration<double> duration = chrono::steady_clock::now() - start;
+    lock.lock();
+
+    zeroCipher.push_back(zero);
+    refilled++;
+    refillTime += duration;
+    if (zeroCipher.size() >= capacity) {
+      fullCondition.notify_all();
+    }
+  }
+  fullCondition.notify_all();
+}
\ No newline at end of file
@@ -5,8 +5,8 @@
 // -------------------- CONSTRUCTOR --------------------
 
 BaseEnroller::BaseEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam,
-               size_t vectorParam)
-    : HersEnroller(ccParam, pkParam, vectorParam) {}
+               size_t vectorParam, PrivateKey<DCRTPoly> skParam)
+    : HersEnroller(ccParam, pkParam, vectorParam, skParam) {}
 
 // -------------------- PUBLIC FUNCTIONS --------------------
 
@@ -17,16 +17,17 @@ void BaseEnroller::serializeDB(vector<vector<double>> &database) {
   size_t numBatches = ceil(double(numVectors) / double(vectorsPerBatch));
 
   // create necessary directory if does not exist
-  string dirpath = "serial/";
+  // serial root may be nested, e.g. one directory per shard
+  string dirpath = serialRoot;
   if(!filesystem::exists(dirpath)) {
-    if(!filesystem::create_directory(dirpath)) {
+    if(!filesystem::create_directories(dirpath)) {
       cerr << "Error: Failed to create directory \"" + dirpath + "\"" << endl;
       return;
     }
   }
 
   // create matrix-specific directories if they don't exist
-  string dirName = "serial/db_baseline/";
+  string dirName = serialRoot + "db_baseline/";
   if(!filesystem::exists(dirName)) {
     if(!filesystem::create_directory(dirName)) {
       cerr << "Error: Failed to create directory \"" + dirName + "\"" << endl;
@@ -34,10 +35,8 @@ void BaseEnroller::serializeDB(vector<vector<double>> &database) {
   }
 
   // normalize all plaintext database vectors
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for (size_t i = 0; i < numVectors; i++) {
-    database[i] = VectorUtils::plaintextNormalize(database[i], VECTOR_DIM);
-  }
+  VectorUtils::plaintextNormalizeBatch(database, VECTOR_DIM);
+  MemoryUtils::ScopedLiveBytes databaseBytes(MemoryUtils::PLAINTEXT_MEMORY, MemoryUtils::templateBytes(database));
 
   // serialize all database vectors in sequential-batched format
   #pragma omp parallel for num_threads(MAX_NUM_CORES)
@@ -47,11 +46,9 @@ void BaseEnroller::serializeDB(vector<vector<double>> &database) {
       copy(database[j + i*vectorsPerBatch].begin(), database[j + i*vectorsPerBatch].end(), currentVector.begin()+j*VECTOR_DIM);
     }
 
-    Ciphertext<DCRTPoly> currentCtxt = OpenFHEWrapper::encryptFromVector(cc, pk, currentVector);
-
-    string filepath = "serial/db_baseline/batch" + to_string(i) + ".bin";
-    if (!Serial::SerializeToFile(filepath, currentCtxt, SerType::BINARY)) {
-      cerr << "Error: serialization failed (cannot write to " + filepath + ")" << endl;
-    }
+    string filepath = serialRoot + "db_baseline/batch" + to_string(i) + ".bin";
+    serializeCipher(currentVector, filepath);
   }
+
+  MemoryUtils::samplePhase("enrollment");
 }
\ No newline at end of file
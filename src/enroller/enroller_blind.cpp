@@ -5,8 +5,8 @@
 // -------------------- CONSTRUCTOR --------------------
 
 BlindEnroller::BlindEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam,
-               size_t vectorParam)
-    : HersEnroller(ccParam, pkParam, vectorParam) {}
+               size_t vectorParam, PrivateKey<DCRTPoly> skParam)
+    : HersEnroller(ccParam, pkParam, vectorParam, skParam) {}
 
 // -------------------- PUBLIC FUNCTIONS --------------------
 
@@ -17,16 +17,17 @@ void BlindEnroller::serializeDB(vector<vector<double>> &database, size_t chunkLe
   size_t numMatrices = ceil(double(numVectors) / double(chunksPerBatch));
 
   // create necessary directory if does not exist
-  string dirName = "serial/";
+  // serial root may be nested, e.g. one directory per shard
+  string dirName = serialRoot;
   if(!filesystem::exists(dirName)) {
-    if(!filesystem::create_directory(dirName)) {
+    if(!filesystem::create_directories(dirName)) {
       cerr << "Error: Failed to create directory \"" + dirName + "\"" << endl;
       return;
     }
   }
 
   // create matrix-specific directories if they don't exist
-  dirName = "serial/db_blind";
+  dirName = serialRoot + "db_blind";
   if(!filesystem::exists(dirName)) {
     if(!filesystem::create_directory(dirName)) {
       cerr << "Error: Failed to create directory \"" + dirName + "\"" << endl;
@@ -35,7 +36,7 @@ void BlindEnroller::serializeDB(vector<vector<double>> &database, size_t chunkLe
 
   for (size_t i = 0; i < numMatrices; i++) {
     // create matrix-specific directories if they don't exist
-    dirName = "serial/db_blind/matrix" + to_string(i);
+    dirName = serialRoot + "db_blind/matrix" + to_string(i);
     if(!filesystem::exists(dirName)) {
       if(!filesystem::create_directory(dirName)) {
         cerr << "Error: Failed to create directory \"" + dirName + "\"" << endl;
@@ -44,10 +45,8 @@ void BlindEnroller::serializeDB(vector<vector<double>> &database, size_t chunkLe
   }
 
   // normalize all plaintext database vectors
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for (size_t i = 0; i < numVectors; i++) {
-    database[i] = VectorUtils::plaintextNormalize(database[i], VECTOR_DIM);
-  }
+  VectorUtils::plaintextNormalizeBatch(database, VECTOR_DIM);
+  MemoryUtils::ScopedLiveBytes databaseBytes(MemoryUtils::PLAINTEXT_MEMORY, MemoryUtils::templateBytes(database));
 
   for(size_t i = 0; i < numMatrices; i++) {
 
@@ -58,6 +57,7 @@ void BlindEnroller::serializeDB(vector<vector<double>> &database, size_t chunkLe
 
   }
 
+  MemoryUtils::samplePhase("enrollment");
   return;
 }
 
@@ -79,12 +79,8 @@ void BlindEnroller::serializeDBThread(vector<vector<double>> &database, size_t c
     
   }
 
-  Ciphertext<DCRTPoly> currentCtxt = OpenFHEWrapper::encryptFromVector(cc, pk, currentVector);
-
-  string filepath = "serial/db_blind/matrix" + to_string(matrix) + "/batch" + to_string(index) + ".bin";
-  if (!Serial::SerializeToFile(filepath, currentCtxt, SerType::BINARY)) {
-    cerr << "Error: serialization failed (cannot write to " + filepath + ")" << endl;
-  }
+  string filepath = serialRoot + "db_blind/matrix" + to_string(matrix) + "/batch" + to_string(index) + ".bin";
+  serializeCipher(currentVector, filepath);
 
   return;
 }
\ No newline at end of file
@@ -5,23 +5,24 @@
 // -------------------- CONSTRUCTOR --------------------
 
 DiagonalEnroller::DiagonalEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam,
-         size_t vectorParam)
-  : HersEnroller(ccParam, pkParam, vectorParam) {}
+         size_t vectorParam, PrivateKey<DCRTPoly> skParam)
+  : HersEnroller(ccParam, pkParam, vectorParam, skParam) {}
 
 // -------------------- PUBLIC FUNCTIONS --------------------
 void DiagonalEnroller::serializeDB(vector<vector<double>> &database) {
 
   // create necessary directory if does not exist
-  string dirName = "serial/";
+  // serial root may be nested, e.g. one directory per shard
+  string dirName = serialRoot;
   if(!filesystem::exists(dirName)) {
-    if(!filesystem::create_directory(dirName)) {
+    if(!filesystem::create_directories(dirName)) {
       cerr << "Error: Failed to create directory \"" + dirName + "\"" << endl;
       return;
     }
   }
 
   // create matrix-specific directories if they don't exist
-  dirName = "serial/db_diagonal";
+  dirName = serialRoot + "db_diagonal";
   if(!filesystem::exists(dirName)) {
     if(!filesystem::create_directory(dirName)) {
       cerr << "Error: Failed to create directory \"" + dirName + "\"" << endl;
@@ -29,10 +30,8 @@ void DiagonalEnroller::serializeDB(vector<vector<double>> &database) {
   }
 
   // normalize all database vectors
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for (size_t i = 0; i < numVectors; i++) {
-    database[i] = VectorUtils::plaintextNormalize(database[i], VECTOR_DIM);
-  }
+  VectorUtils::plaintextNormalizeBatch(database, VECTOR_DIM);
+  MemoryUtils::ScopedLiveBytes databaseBytes(MemoryUtils::PLAINTEXT_MEMORY, MemoryUtils::templateBytes(database));
 
   vector<vector<vector<double>>> squareMatrices = splitIntoSquareMatrices(database, VECTOR_DIM);
   
@@ -44,12 +43,37 @@ void DiagonalEnroller::serializeDB(vector<vector<double>> &database) {
 
   vector<vector<double>> concatenatedRows = concatenateRows(allDiagonalMatrices);
 
-  // encrypt each row 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for (size_t i = 0; i < concatenatedRows.size(); i++) {
-    // cout << i << "\t" << concatenatedRows[i].size() << endl;
-    serializeDBThread(concatenatedRows[i], i);
+  // the intermediate square, diagonal and concatenated layouts are all held at once
+  for (auto &squareMatrix : squareMatrices) {
+    databaseBytes.add(MemoryUtils::templateBytes(squareMatrix));
+  }
+  for (auto &diagonals : allDiagonalMatrices) {
+    databaseBytes.add(MemoryUtils::templateBytes(diagonals));
   }
+  databaseBytes.add(MemoryUtils::templateBytes(concatenatedRows));
+  MemoryUtils::samplePhase("diagonal preprocessing");
+
+  // encrypt each row, checkpointing the manifest after the VECTOR_DIM rows of every matrix
+  EnrollmentManifest manifest(serialRoot + "db_diagonal/", concatenatedRows.size(), EnrollmentManifest::fingerprint(pk, database));
+  for (size_t m = 0; m < concatenatedRows.size(); m += VECTOR_DIM) {
+
+    #pragma omp parallel for num_threads(MAX_NUM_CORES)
+    for (size_t i = m; i < min(m + VECTOR_DIM, concatenatedRows.size()); i++) {
+      // cout << i << "\t" << concatenatedRows[i].size() << endl;
+      string filepath = serialRoot + "db_diagonal/index" + to_string(i) + ".bin";
+      if (manifest.finished(filepath)) {
+        continue;
+      }
+      serializeDBThread(concatenatedRows[i], i);
+      manifest.markFinished(filepath);
+    }
+
+    manifest.checkpoint();
+  }
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  resetGallery(ceil(double(numVectors) / double(batchSize)));
+  MemoryUtils::samplePhase("enrollment");
 }
 
 // -------------------- PROTECTED FUNCTIONS --------------------
@@ -157,10 +181,22 @@ vector<vector<double>> DiagonalEnroller::concatenateRows(const vector<vector<vec
 
 void DiagonalEnroller::serializeDBThread(vector<double> &currentRow, size_t index) {
 
-  Ciphertext<DCRTPoly> currentCtxt = OpenFHEWrapper::encryptFromVector(cc, pk, currentRow);
-  string filepath = "serial/db_diagonal/index" + to_string(index) + ".bin";
-  if (!Serial::SerializeToFile(filepath, currentCtxt, SerType::BINARY)) {
-    cerr << "Error: serialization failed (cannot write to " + filepath + ")" << endl;
-  }
+  string filepath = serialRoot + "db_diagonal/index" + to_string(index) + ".bin";
+  serializeCipher(currentRow, filepath);
+
+}
+
+string DiagonalEnroller::galleryDirectory() {
+  return "db_diagonal/";
+}
+
+
+string DiagonalEnroller::cipherFilepath(size_t matrix, size_t index) {
+  return serialRoot + "db_diagonal/index" + to_string(matrix * VECTOR_DIM + index) + ".bin";
+}
+
 
+// row j of a square matrix holds its dimension d on diagonal (d - j) mod VECTOR_DIM, see preprocessToDiagonalForm
+size_t DiagonalEnroller::cipherIndexOf(size_t vectorIndex, size_t dimension) {
+  return (dimension + VECTOR_DIM - (vectorIndex % VECTOR_DIM)) % VECTOR_DIM;
 }
\ No newline at end of file
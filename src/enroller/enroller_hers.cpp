@@ -5,8 +5,8 @@
 // -------------------- CONSTRUCTOR --------------------
 
 HersEnroller::HersEnroller(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam,
-               size_t vectorParam)
-    : cc(ccParam), pk(pkParam), numVectors(vectorParam) {}
+               size_t vectorParam, PrivateKey<DCRTPoly> skParam)
+    : cc(ccParam), pk(pkParam), sk(skParam), numVectors(vectorParam), serialRoot(SERIAL_ROOT) {}
 
 // -------------------- PUBLIC FUNCTIONS --------------------
 
@@ -17,10 +17,8 @@ HersEnroller::encryptDB(vector<vector<double>> &database) {
   size_t numMatrices = ceil(double(numVectors) / double(batchSize));
 
   // normalize all plaintext database vectors
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for (size_t i = 0; i < numVectors; i++) {
-    database[i] = VectorUtils::plaintextNormalize(database[i], VECTOR_DIM);
-  }
+  VectorUtils::plaintextNormalizeBatch(database, VECTOR_DIM);
+  MemoryUtils::ScopedLiveBytes databaseBytes(MemoryUtils::PLAINTEXT_MEMORY, MemoryUtils::templateBytes(database));
 
   vector<vector<Ciphertext<DCRTPoly>>> databaseCipher( numMatrices, vector<Ciphertext<DCRTPoly>>(VECTOR_DIM) );
 
@@ -34,22 +32,29 @@ HersEnroller::encryptDB(vector<vector<double>> &database) {
 
   }
 
+  MemoryUtils::samplePhase("enrollment");
   return databaseCipher;
 }
 
 
+void HersEnroller::setSerialRoot(const string &root) {
+  serialRoot = root;
+}
+
+
 void HersEnroller::serializeDB(vector<vector<double>> &database) {
 
   // create necessary directories if they do not exist
-  string dirpath = "serial/";
+  // serial root may be nested, e.g. one directory per shard
+  string dirpath = serialRoot;
   if(!filesystem::exists(dirpath)) {
-    if(!filesystem::create_directory(dirpath)) {
+    if(!filesystem::create_directories(dirpath)) {
       cerr << "Error: Failed to create directory \"" + dirpath + "\"" << endl;
       return;
     }
   }
 
-  dirpath = "serial/db_hers/";
+  dirpath = serialRoot + "db_hers/";
   if(!filesystem::exists(dirpath)) {
     if(!filesystem::create_directory(dirpath)) {
       cerr << "Error: Failed to create directory \"" + dirpath + "\"" << endl;
@@ -63,7 +68,7 @@ void HersEnroller::serializeDB(vector<vector<double>> &database) {
   // create matrix-specific directories if they don't exist
   for(size_t i = 0; i < numMatrices; i++) {
     // create necessary directory if does not exist
-    dirpath = "serial/db_hers/matrix" + to_string(i) + "/";
+    dirpath = serialRoot + "db_hers/matrix" + to_string(i) + "/";
     if(!filesystem::exists(dirpath)) {
       if(!filesystem::create_directory(dirpath)) {
         cerr << "Error: Failed to create directory \"" + dirpath + "\"" << endl;
@@ -72,24 +77,245 @@ void HersEnroller::serializeDB(vector<vector<double>> &database) {
   }
 
   // normalize all plaintext database vectors
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for (size_t i = 0; i < numVectors; i++) {
-    database[i] = VectorUtils::plaintextNormalize(database[i], VECTOR_DIM);
-  }
+  VectorUtils::plaintextNormalizeBatch(database, VECTOR_DIM);
+  MemoryUtils::ScopedLiveBytes databaseBytes(MemoryUtils::PLAINTEXT_MEMORY, MemoryUtils::templateBytes(database));
+
+  // the manifest is checkpointed after every matrix, so an interruption loses at most one matrix of ciphers
+  EnrollmentManifest manifest(serialRoot + "db_hers/", numMatrices * VECTOR_DIM, EnrollmentManifest::fingerprint(pk, database));
 
   // encrypt normalized vectors in index-batched format
   for(size_t i = 0; i < numMatrices; i++) {
     
     #pragma omp parallel for num_threads(MAX_NUM_CORES)
     for(size_t j = 0; j < VECTOR_DIM; j++) {
+      string filepath = cipherFilepath(i, j);
+      if (manifest.finished(filepath)) {
+        continue;
+      }
       serializeDBThread(i, j, database);
+      manifest.markFinished(filepath);
     }
 
+    manifest.checkpoint();
   }
+
+  resetGallery(numMatrices);
+  MemoryUtils::samplePhase("enrollment");
+}
+
+
+vector<size_t> HersEnroller::appendVectors(vector<vector<double>> &vectors) {
+
+  vector<size_t> indices;
+  if (!sk) {
+    cerr << "Error: appending to an enrolled gallery requires the secret key" << endl;
+    return indices;
+  }
+
+  VectorUtils::plaintextNormalizeBatch(vectors, VECTOR_DIM);
+
+  // free slots past the last vector are zero, so appended vectors simply take the next database indices
+  map<size_t, vector<double>> appended;
+  for(size_t i = 0; i < vectors.size(); i++) {
+    indices.push_back(numVectors + i);
+    appended[numVectors + i] = vectors[i];
+  }
+
+  rewriteSlots(appended);
+  numVectors += vectors.size();
+  tagEpoch(appended);
+
+  MemoryUtils::samplePhase("enrollment");
+  return indices;
+}
+
+
+void HersEnroller::updateVectors(const vector<size_t> &indices, vector<vector<double>> &vectors) {
+
+  if (!sk) {
+    cerr << "Error: updating an enrolled gallery requires the secret key" << endl;
+    return;
+  }
+  if (indices.size() != vectors.size()) {
+    cerr << "Error: " << indices.size() << " indices given for " << vectors.size() << " vectors" << endl;
+    return;
+  }
+
+  VectorUtils::plaintextNormalizeBatch(vectors, VECTOR_DIM);
+
+  string tombstonePath = serialRoot + galleryDirectory() + TOMBSTONE_FILENAME;
+  set<size_t> tombstones = VectorUtils::readIndexSet(tombstonePath);
+  size_t tombstoneCount = tombstones.size();
+
+  map<size_t, vector<double>> updated;
+  for(size_t i = 0; i < indices.size(); i++) {
+    if (indices[i] >= numVectors) {
+      cerr << "Error: cannot update vector " << indices[i] << " of a gallery of " << numVectors << " vectors" << endl;
+      continue;
+    }
+    updated[indices[i]] = vectors[i];
+    tombstones.erase(indices[i]);
+  }
+
+  rewriteSlots(updated);
+  tagEpoch(updated);
+
+  if (tombstones.size() != tombstoneCount && !VectorUtils::writeIndexSet(tombstonePath, tombstones)) {
+    cerr << "Error: cannot write to \"" << tombstonePath << "\"" << endl;
+  }
+
+  MemoryUtils::samplePhase("enrollment");
+}
+
+
+void HersEnroller::deleteVectors(const vector<size_t> &indices) {
+
+  if (!TOMBSTONE_MASKING && !sk) {
+    cerr << "Error: deleting from an enrolled gallery requires the secret key, unless TOMBSTONE_MASKING is set" << endl;
+    return;
+  }
+
+  string tombstonePath = serialRoot + galleryDirectory() + TOMBSTONE_FILENAME;
+  set<size_t> tombstones = VectorUtils::readIndexSet(tombstonePath);
+
+  map<size_t, vector<double>> zeroed;
+  for(size_t i = 0; i < indices.size(); i++) {
+    if (indices[i] >= numVectors) {
+      cerr << "Error: cannot delete vector " << indices[i] << " of a gallery of " << numVectors << " vectors" << endl;
+      continue;
+    }
+    if (tombstones.insert(indices[i]).second) {
+      zeroed[indices[i]] = vector<double>(VECTOR_DIM, 0.0);
+    }
+  }
+
+  // without masking, a deleted vector must stop matching before its tombstone is visible
+  if (!TOMBSTONE_MASKING) {
+    rewriteSlots(zeroed);
+  }
+
+  if (!VectorUtils::writeIndexSet(tombstonePath, tombstones)) {
+    cerr << "Error: cannot write to \"" << tombstonePath << "\"" << endl;
+  }
+}
+
+
+map<size_t, size_t> HersEnroller::compactGallery() {
+
+  map<size_t, size_t> moved;
+  if (!sk) {
+    cerr << "Error: compacting an enrolled gallery requires the secret key" << endl;
+    return moved;
+  }
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  string tombstonePath = serialRoot + galleryDirectory() + TOMBSTONE_FILENAME;
+  set<size_t> tombstones = VectorUtils::readIndexSet(tombstonePath);
+  if (tombstones.empty()) {
+    return moved;
+  }
+  if (*tombstones.rbegin() >= numVectors) {
+    cerr << "Error: \"" << tombstonePath << "\" lists vector " << *tombstones.rbegin() << " of a gallery of "
+         << numVectors << " vectors" << endl;
+    return moved;
+  }
+
+  size_t liveVectors = numVectors - tombstones.size();
+
+  // live vectors past the new end fill the deleted slots before it, in order
+  vector<size_t> holes;
+  set<size_t> tail;
+  for(set<size_t>::iterator it = tombstones.begin(); it != tombstones.end() && *it < liveVectors; it++) {
+    holes.push_back(*it);
+  }
+  for(size_t k = liveVectors; k < numVectors; k++) {
+    if (tombstones.count(k) == 0) {
+      tail.insert(k);
+    }
+  }
+
+  map<size_t, vector<double>> tailVectors = readSlots(tail);
+  map<size_t, vector<double>> rewritten;
+  size_t h = 0;
+  for(set<size_t>::iterator it = tail.begin(); it != tail.end(); it++, h++) {
+    rewritten[holes[h]] = tailVectors[*it];
+    moved[*it] = holes[h];
+  }
+
+  // the sender compares every slot, so slots of the new last matrix past the live vectors are cleared
+  size_t numMatrices = ceil(double(liveVectors) / double(batchSize));
+  size_t oldMatrices = ceil(double(numVectors) / double(batchSize));
+  for(size_t k = liveVectors; k < min(numVectors, numMatrices * batchSize); k++) {
+    rewritten[k] = vector<double>(VECTOR_DIM, 0.0);
+  }
+  rewriteSlots(rewritten);
+
+  // a moved vector keeps its epoch, so delta queries since an earlier epoch still reach it
+  vector<size_t> epochs = readEpochs();
+  for(map<size_t, size_t>::iterator it = moved.begin(); it != moved.end(); it++) {
+    epochs[it->second / batchSize] = max(epochs[it->second / batchSize], epochs[it->first / batchSize]);
+  }
+  epochs.resize(numMatrices);
+  writeEpochs(epochs);
+
+  numVectors = liveVectors;
+  if (!VectorUtils::writeIndexSet(tombstonePath, set<size_t>())) {
+    cerr << "Error: cannot write to \"" << tombstonePath << "\"" << endl;
+  }
+
+  // matrices past the new end are removed
+  removeMatrices(numMatrices, oldMatrices);
+
+  MemoryUtils::samplePhase("enrollment");
+  return moved;
+}
+
+
+size_t HersEnroller::vectorCount() {
+  return numVectors;
+}
+
+
+size_t HersEnroller::latestEpoch() {
+  vector<size_t> epochs = readEpochs();
+  return epochs.empty() ? 0 : *max_element(epochs.begin(), epochs.end());
 }
 
 // -------------------- PRIVATE FUNCTIONS --------------------
 
+// a smaller gallery serialized over a larger one would otherwise inherit its tombstones and trailing matrices
+void HersEnroller::resetGallery(size_t numMatrices) {
+
+  string tombstonePath = serialRoot + galleryDirectory() + TOMBSTONE_FILENAME;
+  if (!VectorUtils::writeIndexSet(tombstonePath, set<size_t>())) {
+    cerr << "Error: cannot write to \"" << tombstonePath << "\"" << endl;
+  }
+  writeEpochs(vector<size_t>(numMatrices, 0));
+
+  size_t staleEnd = numMatrices;
+  bool stale = true;
+  while (stale) {
+    stale = false;
+    for(size_t i = 0; i < VECTOR_DIM && !stale; i++) {
+      stale = filesystem::exists(cipherFilepath(staleEnd, i));
+    }
+    staleEnd += stale ? 1 : 0;
+  }
+  removeMatrices(numMatrices, staleEnd);
+}
+
+
+void HersEnroller::removeMatrices(size_t first, size_t end) {
+  error_code error;
+  for(size_t m = first; m < end; m++) {
+    for(size_t i = 0; i < VECTOR_DIM; i++) {
+      filesystem::remove(cipherFilepath(m, i), error);
+    }
+    filesystem::remove(filesystem::path(cipherFilepath(m, 0)).parent_path(), error);
+  }
+}
+
+
 Ciphertext<DCRTPoly> HersEnroller::encryptDBThread(size_t matrix, size_t index, vector<vector<double>> &database) {
   size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
   size_t startIndex = matrix * batchSize;
@@ -112,11 +338,158 @@ void HersEnroller::serializeDBThread(size_t matrix, size_t index, vector<vector<
   for(size_t k = startIndex; (k < startIndex + batchSize) && (k < size_t(numVectors)); k++) {
     indexVector[k % batchSize] = database[k][index];
   }
-  
-  Ciphertext<DCRTPoly> ctxt = OpenFHEWrapper::encryptFromVector(cc, pk, indexVector);
 
-  string filepath = "serial/db_hers/matrix" + to_string(matrix) + "/index" + to_string(index) + ".bin";
-  if (!Serial::SerializeToFile(filepath, ctxt, SerType::BINARY)) {
+  string filepath = serialRoot + "db_hers/matrix" + to_string(matrix) + "/index" + to_string(index) + ".bin";
+  serializeCipher(indexVector, filepath);
+}
+
+
+// encrypts and writes a single gallery cipher, seeded if the secret key is available
+void HersEnroller::serializeCipher(vector<double> &values, const string &filepath) {
+
+  bool serialized;
+  if (SEEDED_CIPHERTEXTS && sk) {
+    OpenFHEWrapper::CipherSeed seed;
+    Ciphertext<DCRTPoly> ctxt = OpenFHEWrapper::encryptSeeded(cc, sk, values, seed);
+    serialized = OpenFHEWrapper::serializeSeededToFile(filepath, ctxt, seed);
+  } else {
+    Ciphertext<DCRTPoly> ctxt = OpenFHEWrapper::encryptFromVector(cc, pk, values);
+    serialized = Serial::SerializeToFile(filepath, ctxt, SerType::BINARY);
+  }
+
+  if (!serialized) {
     cerr << "Error: serialization failed (cannot write to " + filepath + ")" << endl;
   }
+}
+
+string HersEnroller::galleryDirectory() {
+  return "db_hers/";
+}
+
+
+string HersEnroller::cipherFilepath(size_t matrix, size_t index) {
+  return serialRoot + "db_hers/matrix" + to_string(matrix) + "/index" + to_string(index) + ".bin";
+}
+
+
+// every vector of the HERS layout keeps dimension d in cipher d
+size_t HersEnroller::cipherIndexOf(size_t /* vectorIndex */, size_t dimension) {
+  return dimension;
+}
+
+
+void HersEnroller::rewriteSlots(const map<size_t, vector<double>> &vectors) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+
+  // group the changed values by cipher, so each affected cipher is rewritten once
+  map<string, vector<pair<size_t, double>>> cipherValues;
+  for(map<size_t, vector<double>>::const_iterator it = vectors.begin(); it != vectors.end(); it++) {
+    size_t matrix = it->first / batchSize;
+    for(size_t d = 0; d < VECTOR_DIM; d++) {
+      string filepath = cipherFilepath(matrix, cipherIndexOf(it->first, d));
+      cipherValues[filepath].push_back(make_pair(it->first % batchSize, it->second[d]));
+    }
+  }
+
+  // directories of new matrices are created before the ciphers are written in parallel
+  vector<pair<string, vector<pair<size_t, double>>>> ciphers(cipherValues.begin(), cipherValues.end());
+  error_code error;
+  for(size_t i = 0; i < ciphers.size(); i++) {
+    filesystem::create_directories(filesystem::path(ciphers[i].first).parent_path(), error);
+  }
+
+  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  for(size_t i = 0; i < ciphers.size(); i++) {
+    rewriteCipher(ciphers[i].first, ciphers[i].second);
+  }
+}
+
+
+// ciphers of a new matrix do not exist yet and start out as zero
+void HersEnroller::rewriteCipher(const string &filepath, const vector<pair<size_t, double>> &slotValues) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  vector<double> values(batchSize, 0.0);
+
+  if (filesystem::exists(filepath)) {
+    Ciphertext<DCRTPoly> ctxt;
+    if (!OpenFHEWrapper::deserializeCipherFromFile(cc, filepath, ctxt)) {
+      cerr << "Error: cannot deserialize from \"" << filepath << "\"" << endl;
+      return;
+    }
+    values = OpenFHEWrapper::decryptToVector(cc, sk, ctxt);
+    values.resize(batchSize);
+  }
+
+  for(size_t i = 0; i < slotValues.size(); i++) {
+    values[slotValues[i].first] = slotValues[i].second;
+  }
+  serializeCipher(values, filepath);
+}
+
+
+map<size_t, vector<double>> HersEnroller::readSlots(const set<size_t> &indices) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+
+  // every output vector is allocated up front, so the parallel decryptions only write into existing entries
+  map<size_t, vector<double>> vectors;
+  map<string, vector<pair<size_t, size_t>>> cipherSlots;
+  for(set<size_t>::const_iterator it = indices.begin(); it != indices.end(); it++) {
+    vectors[*it] = vector<double>(VECTOR_DIM, 0.0);
+    for(size_t d = 0; d < VECTOR_DIM; d++) {
+      cipherSlots[cipherFilepath(*it / batchSize, cipherIndexOf(*it, d))].push_back(make_pair(*it, d));
+    }
+  }
+
+  vector<pair<string, vector<pair<size_t, size_t>>>> ciphers(cipherSlots.begin(), cipherSlots.end());
+
+  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  for(size_t i = 0; i < ciphers.size(); i++) {
+    Ciphertext<DCRTPoly> ctxt;
+    if (!OpenFHEWrapper::deserializeCipherFromFile(cc, ciphers[i].first, ctxt)) {
+      cerr << "Error: cannot deserialize from \"" << ciphers[i].first << "\"" << endl;
+      continue;
+    }
+    vector<double> values = OpenFHEWrapper::decryptToVector(cc, sk, ctxt);
+    for(size_t j = 0; j < ciphers[i].second.size(); j++) {
+      size_t vectorIndex = ciphers[i].second[j].first;
+      vectors.at(vectorIndex)[ciphers[i].second[j].second] = values[vectorIndex % batchSize];
+    }
+  }
+
+  return vectors;
+}
+
+vector<size_t> HersEnroller::readEpochs() {
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  vector<size_t> epochs = VectorUtils::readIndexList(serialRoot + galleryDirectory() + EPOCH_FILENAME);
+  epochs.resize(ceil(double(numVectors) / double(batchSize)), 0);
+  return epochs;
+}
+
+
+void HersEnroller::writeEpochs(const vector<size_t> &epochs) {
+  string filepath = serialRoot + galleryDirectory() + EPOCH_FILENAME;
+  if (!VectorUtils::writeIndexList(filepath, epochs)) {
+    cerr << "Error: cannot write to \"" << filepath << "\"" << endl;
+  }
+}
+
+
+// called once numVectors covers the given vectors, so that new matrices are part of the epoch list
+void HersEnroller::tagEpoch(const map<size_t, vector<double>> &vectors) {
+  if (vectors.empty()) {
+    return;
+  }
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  vector<size_t> epochs = readEpochs();
+  size_t epoch = epochs.empty() ? 1 : *max_element(epochs.begin(), epochs.end()) + 1;
+
+  for(map<size_t, vector<double>>::const_iterator it = vectors.begin(); it != vectors.end(); it++) {
+    epochs[it->first / batchSize] = epoch;
+  }
+  writeEpochs(epochs);
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "../include/enrollment_manifest.h"
+
+// implementation of functions declared in enrollment_manifest.h
+
+namespace {
+
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t fnvUpdate(uint64_t hash, const char *bytes, size_t length) {
+  for(size_t i = 0; i < length; i++) {
+    hash ^= uint64_t(uint8_t(bytes[i]));
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+} // namespace
+
+// -------------------- CONSTRUCTOR --------------------
+
+EnrollmentManifest::EnrollmentManifest(const string &dirpathParam, size_t numUnitsParam, uint64_t fingerprintParam)
+    : dirpath(dirpathParam), manifestPath(dirpathParam + MANIFEST_FILENAME), numUnits(numUnitsParam),
+      galleryFingerprint(fingerprintParam), verifiedCount(0), writtenCount(0), start(chrono::steady_clock::now()) {
+
+  // first line holds the gallery fingerprint, every further line a unit and its checksum
+  ifstream file(manifestPath);
+  string header;
+  uint64_t recordedFingerprint;
+  if (!(file >> header >> recordedFingerprint) || header != "gallery" || recordedFingerprint != galleryFingerprint) {
+    return;
+  }
+
+  string unit;
+  uint64_t hash;
+  while (file >> unit >> hash) {
+    recordedUnits[unit] = hash;
+  }
+  cout << "Resuming enrollment from \"" << manifestPath << "\" (" << recordedUnits.size() << "/" << numUnits
+       << " ciphers recorded)" << endl;
+}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+uint64_t EnrollmentManifest::fingerprint(PublicKey<DCRTPoly> pk, const vector<vector<double>> &database) {
+
+  uint64_t hash = FNV_OFFSET;
+  for(size_t i = 0; i < database.size(); i++) {
+    hash = fnvUpdate(hash, reinterpret_cast<const char *>(database[i].data()), database[i].size() * sizeof(double));
+  }
+
+  stringstream keyStream;
+  Serial::Serialize(pk, keyStream, SerType::BINARY);
+  string keyBytes = keyStream.str();
+  return fnvUpdate(hash, keyBytes.data(), keyBytes.size());
+}
+
+
+bool EnrollmentManifest::finished(const string &filepath) {
+
+  string unit = unitName(filepath);
+  map<string, uint64_t>::const_iterator recorded = recordedUnits.find(unit);
+  uint64_t hash;
+  if (recorded == recordedUnits.end() || !checksum(filepath, hash) || hash != recorded->second) {
+    return false;
+  }
+
+  lock_guard<mutex> lock(unitMutex);
+  finishedUnits[unit] = hash;
+  verifiedCount++;
+  return true;
+}
+
+
+void EnrollmentManifest::markFinished(const string &filepath) {
+
+  uint64_t hash;
+  if (!checksum(filepath, hash)) {
+    cerr << "Error: cannot read back \"" << filepath << "\"" << endl;
+    return;
+  }
+
+  lock_guard<mutex> lock(unitMutex);
+  finishedUnits[unitName(filepath)] = hash;
+  writtenCount++;
+}
+
+// written to a temporary file first and then renamed, so a crash leaves either the old or the new manifest
+void EnrollmentManifest::checkpoint() {
+
+  lock_guard<mutex> lock(unitMutex);
+
+  string tempPath = manifestPath + ".tmp";
+  {
+    ofstream file(tempPath, ios::out | ios::trunc);
+    file << "gallery " << galleryFingerprint << "\n";
+    for(map<string, uint64_t>::iterator it = finishedUnits.begin(); it != finishedUnits.end(); it++) {
+      file << it->first << " " << it->second << "\n";
+    }
+    file.flush();
+    if (!file.good()) {
+      cerr << "Error: cannot write to \"" << tempPath << "\"" << endl;
+      return;
+    }
+  }
+
+  error_code error;
+  filesystem::rename(tempPath, manifestPath, error);
+  if (error) {
+    cerr << "Error: cannot replace \"" << manifestPath << "\"" << endl;
+    return;
+  }
+
+  // throughput only counts ciphers encrypted by this run
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  double throughput = (elapsed.count() > 0.0) ? double(writtenCount) / elapsed.count() : 0.0;
+  size_t remaining = numUnits - min(numUnits, finishedUnits.size());
+  cout << "Enrolled " << finishedUnits.size() << "/" << numUnits << " ciphers (" << verifiedCount
+       << " verified from an earlier run), " << throughput << " ciphers/s";
+  if (throughput > 0.0 && remaining > 0) {
+    cout << ", about " << size_t(double(remaining) / throughput) << "s remaining";
+  }
+  cout << endl;
+}
+
+// -------------------- PRIVATE FUNCTIONS --------------------
+
+bool EnrollmentManifest::checksum(const string &filepath, uint64_t &hash) {
+
+  ifstream file(filepath, ios::in | ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  hash = FNV_OFFSET;
+  vector<char> buffer(1 << 20);
+  while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+    hash = fnvUpdate(hash, buffer.data(), file.gcount());
+  }
+  return true;
+}
+
+// units are named relative to the manifest, so a gallery directory can be moved before resuming
+string EnrollmentManifest::unitName(const string &filepath) {
+  return filesystem::path(filepath).lexically_relative(dirpath).generic_string();
+}
\ No newline at end of file
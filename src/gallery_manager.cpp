@@ -0,0 +1,113 @@
+#include "../include/gallery_manager.h"
+
+// implementation of functions declared in gallery_manager.h
+
+// -------------------- CONSTRUCTOR --------------------
+
+GalleryManager::GalleryManager(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam, SenderFactory factoryParam,
+                               const string &root, size_t numVectors)
+    : cc(ccParam), pk(pkParam), factory(factoryParam), currentVersion(0), loading(false), lastSwapped(false) {
+  current = shared_ptr<Sender>(factory(cc, pk, numVectors));
+  current->setSerialRoot(root);
+}
+
+GalleryManager::~GalleryManager() {
+  if (loader.joinable()) {
+    loader.join();
+  }
+}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+string GalleryManager::versionRoot(size_t version) {
+  return SERIAL_ROOT + "gallery_v" + to_string(version) + "/";
+}
+
+
+shared_ptr<Sender> GalleryManager::acquire() {
+  lock_guard<mutex> lock(currentMutex);
+  return current;
+}
+
+
+size_t GalleryManager::version() {
+  lock_guard<mutex> lock(currentMutex);
+  return currentVersion;
+}
+
+
+bool GalleryManager::stage(const string &root, size_t numVectors) {
+  if (loading.exchange(true)) {
+    return false;
+  }
+  if (loader.joinable()) {
+    loader.join();
+  }
+  loader = thread(&GalleryManager::loadVersion, this, root, numVectors);
+  return true;
+}
+
+
+bool GalleryManager::waitForSwap() {
+  if (loader.joinable()) {
+    loader.join();
+  }
+  return lastSwapped;
+}
+
+// -------------------- PRIVATE FUNCTIONS --------------------
+
+bool GalleryManager::warmGallery(const string &root, size_t &fileCount, uintmax_t &byteCount) {
+
+  fileCount = 0;
+  byteCount = 0;
+  error_code error;
+  if (!filesystem::is_directory(root, error)) {
+    return false;
+  }
+
+  vector<char> buffer(1 << 20);
+  for(filesystem::recursive_directory_iterator it(root, error), end; it != end && !error; it.increment(error)) {
+    // only the db_* layouts, a version root may also hold other versions or shards below it
+    string relative = filesystem::relative(it->path(), root).string();
+    if (!it->is_regular_file() || relative.rfind("db_", 0) != 0) {
+      continue;
+    }
+
+    ifstream file(it->path(), ios::in | ios::binary);
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+      byteCount += file.gcount();
+    }
+    fileCount++;
+  }
+  return !error && fileCount > 0;
+}
+
+// runs on the loader thread, queries keep being served from the current version meanwhile
+void GalleryManager::loadVersion(string root, size_t numVectors) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  size_t fileCount;
+  uintmax_t byteCount;
+  lastSwapped = false;
+
+  if (!warmGallery(root, fileCount, byteCount)) {
+    cerr << "Error: no enrolled gallery found in \"" << root << "\"" << endl;
+    loading = false;
+    return;
+  }
+
+  shared_ptr<Sender> staged(factory(cc, pk, numVectors));
+  staged->setSerialRoot(root);
+  {
+    lock_guard<mutex> lock(currentMutex);
+    current = staged;
+    currentVersion++;
+  }
+  lastSwapped = true;
+
+  chrono::duration<double> duration = chrono::steady_clock::now() - start;
+  cout << "Gallery \"" << root << "\" (" << numVectors << " vectors, " << fileCount << " files, " << byteCount
+       << " bytes) loaded in " << duration.count() << "s and swapped in" << endl;
+  loading = false;
+}
\ No newline at end of file
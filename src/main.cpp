@@ -1,14 +1,21 @@
 // General functionality header files
+#include "../include/blocking_queue.h"
 #include "../include/config.h"
 #include "../include/vector_utils.h"
+#include "../include/memory_utils.h"
 #include "../include/openFHE_wrapper.h"
+#include "../include/trace_utils.h"
 #include "openfhe.h"
 #include <iostream>
 #include <ctime>
+#include <atomic>
+#include <sstream>
+#include <thread>
 
 // Receiver class header files
 #include "../include/receiver_base.h"
 #include "../include/receiver_blind.h"
+#include "../include/receiver_compact.h"
 #include "../include/receiver_diag.h"
 #include "../include/receiver_grote.h"
 #include "../include/receiver_hers.h"
@@ -22,9 +29,11 @@
 // Sender class header files
 #include "../include/sender_base.h"
 #include "../include/sender_blind.h"
+#include "../include/sender_compact.h"
 #include "../include/sender_diag.h"
 #include "../include/sender_grote.h"
 #include "../include/sender_hers.h"
+#include "../include/sender_multi.h"
 
 // Header files needed for serialization
 #include "ciphertext-ser.h"
@@ -35,6 +44,134 @@
 using namespace lbcrypto;
 using namespace std;
 
+// Plaintext approach 0: same query flow without encryption, reports the raw compute floor
+// Communication sizes and decryption times are reported as zero
+void runPlaintextApproach(ifstream &fileStream, ofstream &expStream, size_t numVectors) {
+
+  chrono::steady_clock::time_point start, end;
+  chrono::duration<double> duration;
+  expStream << numVectors << "," << flush;
+  string memoryLabel = "Plaintext," + to_string(numVectors);
+
+  vector<double> queryVector(VECTOR_DIM);
+  for (size_t i = 0; i < VECTOR_DIM; i++) {
+    fileStream >> queryVector[i];
+  }
+
+  cout << "Reading database vectors from file... " << endl;
+  vector<double> databaseMatrix(numVectors * VECTOR_DIM);
+  for (size_t i = 0; i < numVectors * VECTOR_DIM; i++) {
+    fileStream >> databaseMatrix[i];
+  }
+  fileStream.close();
+
+  cout << "Normalizing database vectors (" << VectorUtils::simdLevel() << ")... " << endl;
+  VectorUtils::plaintextNormalizeBatch(databaseMatrix, VECTOR_DIM);
+  MemoryUtils::samplePhase("enrollment");
+  MemoryUtils::writeSamples(MEMORY_FILEPATH, memoryLabel + ",enrollment", MemoryUtils::takeSamples());
+
+  cout << endl << "\tRunning Experiments:" << endl;
+
+  cout << "[Receiver]\tNormalizing query vector... " << flush;
+  start = chrono::steady_clock::now();
+  queryVector = VectorUtils::plaintextNormalize(queryVector, VECTOR_DIM);
+  end = chrono::steady_clock::now();
+  duration = end - start;
+  cout << "done (" << duration.count() << "s)" << endl;
+  expStream << duration.count() << "," << 0 << "," << 0 << "," << flush;
+
+  cout << "[Sender]\tComputing membership scenario... " << flush;
+  start = chrono::steady_clock::now();
+  vector<double> scores = VectorUtils::plaintextCosineScores({queryVector}, databaseMatrix, VECTOR_DIM)[0];
+  bool membershipResult = any_of(scores.begin(), scores.end(), [](double s) { return s >= MATCH_THRESHOLD; });
+  end = chrono::steady_clock::now();
+  duration = end - start;
+  cout << "done (" << duration.count() << "s)" << endl;
+  expStream << duration.count() << "," << 0 << "," << 0 << "," << 0 << "," << flush;
+
+  cout << "[Sender]\tComputing index scenario... " << flush;
+  start = chrono::steady_clock::now();
+  scores = VectorUtils::plaintextCosineScores({queryVector}, databaseMatrix, VECTOR_DIM)[0];
+  vector<size_t> indexResults;
+  for (size_t i = 0; i < numVectors; i++) {
+    if (scores[i] >= MATCH_THRESHOLD) {
+      indexResults.push_back(i);
+    }
+  }
+  end = chrono::steady_clock::now();
+  duration = end - start;
+  cout << "done (" << duration.count() << "s)" << endl;
+  expStream << duration.count() << "," << 0 << "," << 0 << "," << 0 << "," << flush;
+
+  cout << endl << "\tDisplaying Query Results:" << endl;
+  cout << "Membership scenario: " << (membershipResult ? "true" : "false") << endl;
+  expStream << (membershipResult ? "true" : "false") << "," << flush;
+  cout << "Index scenario: " << indexResults << endl;
+  expStream << indexResults << "," << flush;
+
+  MemoryUtils::samplePhase("query complete");
+  MemoryUtils::writeSamples(MEMORY_FILEPATH, memoryLabel + ",query", MemoryUtils::takeSamples());
+  expStream << endl;
+}
+
+// Argmax tournament rounds fold at most 2^(ARGMAX_ROUNDS - 2) result ciphers, checked before any keys are made
+// since every further round would cost ARGMAX_STEP_DEPTH + 1 levels of depth
+bool argmaxFits(size_t numVectors, size_t batchSize) {
+
+  size_t numCiphers = ceil(double(numVectors) / double(batchSize));
+  if (OpenFHEWrapper::argmaxBlockLength(numCiphers) > 0) {
+    return true;
+  }
+
+  size_t maxVectors = (size_t(1) << (ARGMAX_ROUNDS - 2)) * batchSize;
+  cerr << "Error: argmax results cover at most " << maxVectors << " vectors with ARGMAX_ROUNDS = " << ARGMAX_ROUNDS
+       << ", but the database holds " << numVectors << " (" << numCiphers << " result ciphers)" << endl;
+  cerr << "       use the index scenario, or raise ARGMAX_ROUNDS at a cost of " << ARGMAX_STEP_DEPTH + 1
+       << " levels of depth per round" << endl;
+  return false;
+}
+
+// Cosine scores of the query against every database vector, the exact reference for encrypted results
+vector<double> plaintextScores(const vector<double> &queryVector, const vector<vector<double>> &database) {
+  vector<double> databaseMatrix = VectorUtils::flattenVectors(database, VECTOR_DIM);
+  VectorUtils::plaintextNormalizeBatch(databaseMatrix, VECTOR_DIM);
+  vector<double> normalizedQuery = VectorUtils::plaintextNormalize(queryVector, VECTOR_DIM);
+  return VectorUtils::plaintextCosineScores({normalizedQuery}, databaseMatrix, VECTOR_DIM)[0];
+}
+
+// Builds the gallery incrementally: serializeDB enrolls the enroller's initial vectors, appendVectors the rest
+// With a nonzero deleteStride, every deleteStride-th vector from index 2 on is then deleted and the gallery compacted
+// Returns the final database index of every vector, SIZE_MAX for deleted ones
+template <class EnrollerType>
+vector<size_t> enrollIncrementally(EnrollerType &enroller, const vector<vector<double>> &database, size_t deleteStride) {
+
+  size_t initialVectors = enroller.vectorCount();
+  vector<vector<double>> initial(database.begin(), database.begin() + initialVectors);
+  vector<vector<double>> appended(database.begin() + initialVectors, database.end());
+  enroller.serializeDB(initial);
+  vector<size_t> appendedIndices = enroller.appendVectors(appended);
+  cout << "Enrolled " << initialVectors << " vectors, appended " << appendedIndices.size() << endl;
+
+  vector<size_t> finalIndex(database.size());
+  iota(finalIndex.begin(), finalIndex.end(), 0);
+  if (deleteStride == 0) {
+    return finalIndex;
+  }
+
+  vector<size_t> deleted;
+  for(size_t k = 2; k < database.size(); k += deleteStride) {
+    deleted.push_back(k);
+    finalIndex[k] = SIZE_MAX;
+  }
+  enroller.deleteVectors(deleted);
+  map<size_t, size_t> moved = enroller.compactGallery();
+  for(map<size_t, size_t>::iterator it = moved.begin(); it != moved.end(); it++) {
+    finalIndex[it->first] = it->second;
+  }
+  cout << "Deleted " << deleted.size() << " vectors, compaction moved " << moved.size() << " into their slots" << endl;
+  return finalIndex;
+}
+
 // Entry point of the application that orchestrates the flow
 
 int main(int argc, char *argv[]) {
@@ -64,8 +201,39 @@ int main(int argc, char *argv[]) {
     cerr << "Error: approach argument not included" << endl;
     return 1;
   }
-  if (expApproach < 1 || expApproach > 5) {
-    cerr << "Error: approach must be from 1 to 5" << endl;
+  if (expApproach > 6) {
+    cerr << "Error: approach must be from 0 to 6" << endl;
+    return 1;
+  }
+
+  // Parse optional command line arg for the index scenario variant
+  string scenario = "index";
+  if (argc > 3) {
+    scenario = argv[3];
+  }
+  if (scenario != "index" && scenario != "sparse" && scenario != "argmax" && scenario != "score" && scenario != "tiered"
+      && scenario != "stream" && scenario != "multi" && scenario != "incremental" && scenario != "delta") {
+    cerr << "Error: scenario must be \"index\", \"sparse\", \"argmax\", \"score\", \"tiered\", \"stream\", \"multi\", \"incremental\" or \"delta\"" << endl;
+    return 1;
+  }
+  if (scenario == "multi" && expApproach != 5) {
+    cerr << "Error: multi-gallery results are only supported by the diagonal approach" << endl;
+    return 1;
+  }
+  if (scenario == "sparse" && expApproach == 2) {
+    cerr << "Error: sparse index results are not supported by the GROTE approach" << endl;
+    return 1;
+  }
+  if (scenario == "argmax" && expApproach < 4) {
+    cerr << "Error: argmax results are only supported by the HERS and diagonal approaches" << endl;
+    return 1;
+  }
+  if ((scenario == "tiered" || scenario == "stream") && expApproach == 2) {
+    cerr << "Error: " << scenario << " results are not supported by the GROTE approach" << endl;
+    return 1;
+  }
+  if ((scenario == "incremental" || scenario == "delta") && (expApproach < 4 || READ_FROM_SERIAL)) {
+    cerr << "Error: " << scenario << " galleries are enrolled by the HERS and diagonal enrollers, with READ_FROM_SERIAL unset" << endl;
     return 1;
   }
 
@@ -77,37 +245,67 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  // Plaintext approach bypasses the CKKS setup entirely
+  if (expApproach == 0) {
+    cout << "Experimental approach: Plaintext floor" << endl;
+    expStream << "Plaintext," << flush;
+    runPlaintextApproach(fileStream, expStream, numVectors);
+    expStream.close();
+    cout << endl << "\tProgram successfully terminated" << endl;
+    return 0;
+  }
+
   // Compute required multiplicative depth based on approach used
   // Write approach used to stdout and experiment .csv file
   size_t multDepth = OpenFHEWrapper::computeRequiredDepth(expApproach);
+  if (scenario == "score") {
+    multDepth = OpenFHEWrapper::computeScoreDepth(expApproach);
+  } else if (scenario == "argmax") {
+    multDepth += OpenFHEWrapper::computeArgmaxDepth();
+  } else if (scenario == "tiered") {
+    multDepth += OpenFHEWrapper::computeTieredDepth();
+  }
+  string approachName;
   switch(expApproach) {
     
     case 1:
       cout << "Experimental approach: Literature baseline" << endl;
-      expStream << "Baseline," << flush;
+      approachName = "Baseline";
       break;
 
     case 2:
       cout << "Experimental approach: GROTE Paper" << endl;
-      expStream << "GROTE," << flush;
+      approachName = "GROTE";
       break;
 
     case 3:
       cout << "Experimental approach: Blind-Match paper" << endl;
-      expStream << "Blind," << flush;
+      approachName = "Blind";
       break;
 
     case 4:
       cout << "Experimental approach: HERS paper" << endl;
-      expStream << "HERS," << flush;
+      approachName = "HERS";
       break;
     
     case 5:
       cout << "Experimental approach: Novel diagonal transform" << endl;
-      expStream << "Diagonal," << flush;
+      approachName = "Diagonal";
+      break;
+
+    case 6:
+      cout << "Experimental approach: HERS with server-side query expansion" << endl;
+      approachName = "HERS-Compact";
       break;
   }
 
+  // Non-default scenarios are tagged onto the approach name
+  if (scenario != "index") {
+    approachName += " (" + scenario + ")";
+    cout << "Index scenario: " << scenario << endl;
+  }
+  expStream << approachName << "," << flush;
+
   // Declare CKKS scheme elements
   CryptoContext<DCRTPoly> cc;
   cc->ClearEvalMultKeys();
@@ -125,6 +323,9 @@ int main(int argc, char *argv[]) {
       cerr << "Error deserializing CryptoContext" << endl;
     }
     batchSize = cc->GetEncodingParams()->GetBatchSize();
+    if (scenario == "argmax" && !argmaxFits(numVectors, batchSize)) {
+      return 1;
+    }
 
     if (!Serial::DeserializeFromFile("serial/publickey.bin", pk, SerType::BINARY)) {
       cerr << "Error deserializing public key" << endl;
@@ -179,6 +380,9 @@ int main(int argc, char *argv[]) {
     cc->Enable(ADVANCEDSHE);
 
     batchSize = cc->GetEncodingParams()->GetBatchSize();
+    if (scenario == "argmax" && !argmaxFits(numVectors, batchSize)) {
+      return 1;
+    }
 
     cout << "Generating key pair... " << endl;
     auto keyPair = cc->KeyGen();
@@ -205,12 +409,14 @@ int main(int argc, char *argv[]) {
     }
     cc->EvalRotateKeyGen(sk, rotationFactors);
   }
+  MemoryUtils::samplePhase("key generation");
 
   // OpenFHEWrapper::printSchemeDetails(parameters, cc);
   cout << "CKKS scheme set up (depth = " << multDepth << ", batch size = " << batchSize << ")" << endl;
 
   // Log number of vectors to experiment file
   expStream << numVectors << "," << flush;
+  string memoryLabel = approachName + "," + to_string(numVectors);
 
   // Read in query vector from file
   vector<double> queryVector(VECTOR_DIM);
@@ -220,6 +426,7 @@ int main(int argc, char *argv[]) {
   
   // Serialize the context, keys and database vectors if not already
   vector<vector<double>> plaintextVectors(numVectors, vector<double>(VECTOR_DIM));
+  vector<size_t> finalIndex;
   if (!READ_FROM_SERIAL) {
     
     cout << "Reading database vectors from file... " << endl;
@@ -233,21 +440,45 @@ int main(int argc, char *argv[]) {
     // Classes stored on heap to allow for cleaner polymorphism
     HersEnroller *enroller;
 
-    if (expApproach == 1 || expApproach == 2) {
-      enroller = new BaseEnroller(cc, pk, numVectors);
+    if (scenario == "incremental" || scenario == "delta") {
+      // delta galleries only append, so that the appended matrices are the ones tagged after epoch 0
+      size_t deleteStride = (scenario == "incremental") ? INCREMENTAL_DELETE_STRIDE : 0;
+      if (expApproach == 5) {
+        enroller = new DiagonalEnroller(cc, pk, numVectors / 2, sk);
+        finalIndex = enrollIncrementally(*static_cast<DiagonalEnroller*>(enroller), plaintextVectors, deleteStride);
+      } else {
+        enroller = new HersEnroller(cc, pk, numVectors / 2, sk);
+        finalIndex = enrollIncrementally(*enroller, plaintextVectors, deleteStride);
+      }
+      // the compacted gallery is queried at its final size
+      numVectors = enroller->vectorCount();
+    } else if (expApproach == 1 || expApproach == 2) {
+      enroller = new BaseEnroller(cc, pk, numVectors, sk);
       static_cast<BaseEnroller*>(enroller)->serializeDB(plaintextVectors);
     } else if (expApproach == 3) {
-      enroller = new BlindEnroller(cc, pk, numVectors);
+      enroller = new BlindEnroller(cc, pk, numVectors, sk);
       static_cast<BlindEnroller*>(enroller)->serializeDB(plaintextVectors, CHUNK_LEN);
-    } else if (expApproach == 4) {
-      enroller = new HersEnroller(cc, pk, numVectors);
+    } else if (expApproach == 4 || expApproach == 6) {
+      enroller = new HersEnroller(cc, pk, numVectors, sk);
       static_cast<HersEnroller*>(enroller)->serializeDB(plaintextVectors);
     } else if (expApproach == 5) {
-      enroller = new DiagonalEnroller(cc, pk, numVectors);
+      enroller = new DiagonalEnroller(cc, pk, numVectors, sk);
       static_cast<DiagonalEnroller*>(enroller)->serializeDB(plaintextVectors);
     }
     delete enroller;
 
+    // the multi-gallery scenario additionally splits the database into MULTI_GALLERY_COUNT watchlists
+    if (scenario == "multi") {
+      for(size_t g = 0; g < MULTI_GALLERY_COUNT; g++) {
+        size_t first = g * numVectors / MULTI_GALLERY_COUNT;
+        size_t last = (g + 1) * numVectors / MULTI_GALLERY_COUNT;
+        vector<vector<double>> watchlist(plaintextVectors.begin() + first, plaintextVectors.begin() + last);
+        DiagonalEnroller watchlistEnroller(cc, pk, watchlist.size(), sk);
+        watchlistEnroller.setSerialRoot(SERIAL_ROOT + "watchlist" + to_string(g) + "/");
+        watchlistEnroller.serializeDB(watchlist);
+      }
+    }
+
     Serial::SerializeToFile("serial/cryptocontext.bin", cc, SerType::BINARY);
     Serial::SerializeToFile("serial/publickey.bin", pk, SerType::BINARY);
     Serial::SerializeToFile("serial/privatekey.bin", sk, SerType::BINARY);
@@ -286,6 +517,9 @@ int main(int argc, char *argv[]) {
   }
   fileStream.close();
 
+  // Report memory usage of setup and enrollment phases
+  MemoryUtils::writeSamples(MEMORY_FILEPATH, memoryLabel + ",enrollment", MemoryUtils::takeSamples());
+
   // Individual-query experiments begin here
   cout << endl << "\tRunning Experiments:" << endl;
   chrono::steady_clock::time_point start, end;
@@ -295,6 +529,8 @@ int main(int argc, char *argv[]) {
   Sender *sender = nullptr;
   bool membershipResult;
   vector<size_t> indexResults;
+  vector<bool> tierMembership;
+  vector<vector<size_t>> tierResults;
 
   // Allocate receiver and sender objects
   // receiver = new BaseReceiver(cc, pk, sk, numVectors);
@@ -325,54 +561,253 @@ int main(int argc, char *argv[]) {
       receiver = new DiagonalReceiver(cc, pk, sk, numVectors);
       sender = new DiagonalSender(cc, pk, numVectors);
       break;
+
+    case 6:
+      receiver = new CompactReceiver(cc, pk, sk, numVectors);
+      sender = new CompactSender(cc, pk, numVectors);
+      break;
+  }
+
+  // Watchlists are named after their position, and gallery g starts at database index g * numVectors / MULTI_GALLERY_COUNT
+  MultiGallerySender *multiSender = nullptr;
+  vector<string> watchlistNames;
+  if (scenario == "multi") {
+    multiSender = new MultiGallerySender(cc, pk);
+    for(size_t g = 0; g < MULTI_GALLERY_COUNT; g++) {
+      size_t first = g * numVectors / MULTI_GALLERY_COUNT;
+      size_t last = (g + 1) * numVectors / MULTI_GALLERY_COUNT;
+      watchlistNames.push_back("watchlist" + to_string(g));
+      multiSender->addGallery(watchlistNames.back(), SERIAL_ROOT + watchlistNames.back() + "/", last - first);
+    }
+  }
+
+  // Encryptions of zero are precomputed while the receiver waits for a query to be captured
+  if (ENCRYPTION_POOL_QUERIES > 0) {
+    cout << "[Receiver]\tFilling encryption pool... " << flush;
+    start = chrono::steady_clock::now();
+    receiver->startEncryptionPool(ENCRYPTION_POOL_QUERIES);
+    receiver->encryptionPool()->waitUntilFull();
+    end = chrono::steady_clock::now();
+    duration = end - start;
+    cout << "done (" << duration.count() << "s)" << endl;
   }
 
   // Normalize, batch, and encrypt the query vector
+  TraceUtils::beginQuery();
   cout << "[Receiver]\tEncrypting query vector... " << flush;
   start = chrono::steady_clock::now();
   vector<Ciphertext<DCRTPoly>> queryCipher = receiver->encryptQuery(queryVector);
   end = chrono::steady_clock::now();
   duration = end - start;
+  TraceUtils::recordSpan("query encryption", "phase", start, end);
+  MemoryUtils::samplePhase("query encryption");
   cout << "done (" << duration.count() << "s)" << endl;
   expStream << duration.count() << "," << flush; // report query encryption time
   expStream << queryCipher.size() << "," << flush; // report query communication overhead
+  expStream << receiver->queryBytes(queryCipher) << "," << flush;
 
-  // Perform membership scenario
-  cout << "[Sender]\tComputing membership scenario... " << flush;
-  start = chrono::steady_clock::now();
-  Ciphertext<DCRTPoly> membershipCipher = sender->membershipScenario(queryCipher);
-  end = chrono::steady_clock::now();
-  duration = end - start;
-  cout << "done (" << duration.count() << "s)" << endl;
-  expStream << duration.count() << "," << flush; // report membership computation time
-  expStream << 1 << "," << flush; // report membership communication overhead
+  // The pool would only refill from here on, taking cores from the timed sender phases
+  if (receiver->encryptionPool() != nullptr) {
+    receiver->encryptionPool()->stopRefill();
+  }
 
-  cout << "[Receiver]\tDecrypting membership results... " << flush;
-  start = chrono::steady_clock::now();
-  membershipResult = receiver->decryptMembership(membershipCipher);
-  end = chrono::steady_clock::now();
-  duration = end - start;
-  cout << "done (" << duration.count() << "s)" << endl;
-  expStream << duration.count() << "," << flush;
+  // Perform membership scenario
+  // Score-only contexts cannot evaluate the comparison, so membership is taken from the thresholded scores instead
+  // Tiered membership results are summed from the tiered index results and reported with them
+  // Multi-gallery membership results are computed together with the index results of each gallery
+  if (scenario == "score" || scenario == "tiered" || scenario == "multi") {
+    expStream << 0 << "," << 0 << "," << 0 << "," << 0 << "," << flush;
+  } else {
+    cout << "[Sender]\tComputing membership scenario... " << flush;
+    start = chrono::steady_clock::now();
+    Ciphertext<DCRTPoly> membershipCipher = sender->membershipScenario(queryCipher);
+    sender->finalizeMembership(membershipCipher);
+    end = chrono::steady_clock::now();
+    duration = end - start;
+    TraceUtils::recordSpan("membership computation", "phase", start, end);
+    MemoryUtils::samplePhase("membership computation");
+    cout << "done (" << duration.count() << "s)" << endl;
+    expStream << duration.count() << "," << flush; // report membership computation time
+    expStream << 1 << "," << flush; // report membership communication overhead
+    expStream << OpenFHEWrapper::serializedBytes(membershipCipher) << "," << flush;
+
+    cout << "[Receiver]\tDecrypting membership results... " << flush;
+    start = chrono::steady_clock::now();
+    membershipResult = receiver->decryptMembership(membershipCipher);
+    end = chrono::steady_clock::now();
+    duration = end - start;
+    TraceUtils::recordSpan("membership decryption", "phase", start, end);
+    cout << "done (" << duration.count() << "s)" << endl;
+    expStream << duration.count() << "," << flush;
+  }
 
   // Perform index scenario
   cout << "[Sender]\tComputing index scenario... " << flush;
   start = chrono::steady_clock::now();
-  auto indexCipher = sender->indexScenario(queryCipher);
+  vector<Ciphertext<DCRTPoly>> indexCipher;
+  vector<vector<Ciphertext<DCRTPoly>>> tierCipher;
+  vector<Ciphertext<DCRTPoly>> tierMembershipCipher;
+  BlockingQueue<pair<size_t, string>> streamQueue;
+  thread streamReceiver;
+  atomic<size_t> streamCiphers(0);
+  atomic<size_t> streamBytes(0);
+  vector<size_t> streamResults;
+  chrono::duration<double> streamFirstMatch(0.0);
+  map<string, MultiGallerySender::GalleryResult> galleryCipher;
+  vector<bool> galleryMembership;
+  vector<vector<size_t>> galleryResults;
+  if (scenario == "multi") {
+    galleryCipher = multiSender->multiGalleryScenario(queryCipher, watchlistNames);
+    for(size_t g = 0; g < watchlistNames.size(); g++) {
+      MultiGallerySender::GalleryResult &result = galleryCipher[watchlistNames[g]];
+      multiSender->finalizeMembership(result.membershipCipher);
+      multiSender->finalizeIndex(result.indexCipher);
+      indexCipher.insert(indexCipher.end(), result.indexCipher.begin(), result.indexCipher.end());
+      indexCipher.push_back(result.membershipCipher);
+    }
+  } else if (scenario == "sparse") {
+    indexCipher = sender->indexScenarioSparse(queryCipher);
+    sender->finalizeSparseIndex(indexCipher);
+  } else if (scenario == "score") {
+    indexCipher = sender->scoreScenario(queryCipher);
+    sender->finalizeScores(indexCipher);
+  } else if (scenario == "argmax") {
+    indexCipher.push_back(sender->argmaxScenario(queryCipher));
+    sender->finalizeArgmax(indexCipher[0]);
+  } else if (scenario == "tiered") {
+    tierCipher = sender->tieredScenario(queryCipher, MATCH_TIERS);
+    tierMembershipCipher = sender->tieredMembership(tierCipher);
+    for(size_t t = 0; t < tierCipher.size(); t++) {
+      sender->finalizeMembership(tierMembershipCipher[t]);
+      sender->finalizeIndex(tierCipher[t]);
+      indexCipher.insert(indexCipher.end(), tierCipher[t].begin(), tierCipher[t].end());
+    }
+    indexCipher.insert(indexCipher.end(), tierMembershipCipher.begin(), tierMembershipCipher.end());
+  } else if (scenario == "stream") {
+    // the receiver deserializes and decrypts each result on its own thread while the sender is still computing
+    chrono::steady_clock::time_point streamStart = start;
+    streamReceiver = thread([&, streamStart]() {
+      pair<size_t, string> response;
+      while (streamQueue.pop(response)) {
+        stringstream responseStream(response.second);
+        Ciphertext<DCRTPoly> responseCipher;
+        Serial::Deserialize(responseCipher, responseStream, SerType::BINARY);
+        vector<size_t> matches = receiver->decryptIndexCipher(responseCipher, response.first);
+        if (!matches.empty() && streamResults.empty()) {
+          streamFirstMatch = chrono::steady_clock::now() - streamStart;
+        }
+        streamResults.insert(streamResults.end(), matches.begin(), matches.end());
+      }
+    });
+    sender->indexScenarioStream(queryCipher, [&](size_t cipherIndex, Ciphertext<DCRTPoly> resultCipher) {
+      sender->finalizeIndex(resultCipher);
+      stringstream serialStream;
+      Serial::Serialize(resultCipher, serialStream, SerType::BINARY);
+      string serial = serialStream.str();
+      streamCiphers++;
+      streamBytes += serial.size();
+      streamQueue.push(make_pair(cipherIndex, move(serial)));
+    });
+    streamQueue.close();
+  } else {
+    indexCipher = sender->indexScenario(queryCipher);
+    sender->finalizeIndex(indexCipher);
+  }
   end = chrono::steady_clock::now();
   duration = end - start;
+  TraceUtils::recordSpan("index computation", "phase", start, end);
+  MemoryUtils::samplePhase("index computation");
   cout << "done (" << duration.count() << "s)" << endl;
   expStream << duration.count() << "," << flush; // report index computation time
-  expStream << indexCipher.size() << "," << flush; // report index communication overhead
+  if (scenario == "stream") {
+    expStream << streamCiphers << "," << streamBytes << "," << flush;
+  } else {
+    expStream << indexCipher.size() << "," << flush; // report index communication overhead
+    expStream << OpenFHEWrapper::serializedBytes(indexCipher) << "," << flush;
+  }
 
   cout << "[Receiver]\tDecrypting index results... " << flush;
   start = chrono::steady_clock::now();
-  indexResults = receiver->decryptIndex(indexCipher);
+  if (scenario == "multi") {
+    // per-gallery positions are shifted to database indices, matches of any watchlist are reported overall
+    membershipResult = false;
+    for(size_t g = 0; g < watchlistNames.size(); g++) {
+      MultiGallerySender::GalleryResult &result = galleryCipher[watchlistNames[g]];
+      size_t first = g * numVectors / MULTI_GALLERY_COUNT;
+      galleryMembership.push_back(receiver->decryptMembership(result.membershipCipher));
+      galleryResults.push_back(vector<size_t>());
+      for(size_t i = 0; i < result.indexCipher.size(); i++) {
+        vector<size_t> matches = receiver->decryptIndexCipher(result.indexCipher[i], i);
+        for(size_t j = 0; j < matches.size(); j++) {
+          galleryResults[g].push_back(first + matches[j]);
+        }
+      }
+      membershipResult = membershipResult || galleryMembership[g];
+      indexResults.insert(indexResults.end(), galleryResults[g].begin(), galleryResults[g].end());
+    }
+  } else if (scenario == "sparse") {
+    indexResults = receiver->decryptIndexSparse(indexCipher);
+  } else if (scenario == "score") {
+    indexResults = receiver->decryptIndexFromScores(indexCipher);
+    membershipResult = !indexResults.empty();
+  } else if (scenario == "argmax") {
+    indexResults = receiver->decryptArgmax(indexCipher[0]);
+  } else if (scenario == "tiered") {
+    // the most investigative tier is reported as the overall result, as it contains the other tiers
+    for(size_t t = 0; t < tierCipher.size(); t++) {
+      tierMembership.push_back(receiver->decryptMembership(tierMembershipCipher[t]));
+      tierResults.push_back(receiver->decryptIndex(tierCipher[t]));
+    }
+    membershipResult = tierMembership.back();
+    indexResults = tierResults.back();
+  } else if (scenario == "stream") {
+    // only the decryption still pending once the sender has finished is counted here
+    streamReceiver.join();
+    sort(streamResults.begin(), streamResults.end());
+    indexResults = streamResults;
+  } else {
+    indexResults = receiver->decryptIndex(indexCipher);
+  }
   end = chrono::steady_clock::now();
   duration = end - start;
+  TraceUtils::recordSpan("index decryption", "phase", start, end);
   cout << "done (" << duration.count() << "s)" << endl;
   expStream << duration.count() << "," << flush;
 
+  // The query is re-checked against the matrices enrolled since epoch 0, i.e. those the appends changed
+  // decrypted at their global indices, the matches must equal the full index results within these matrices
+  vector<size_t> deltaResults;
+  vector<size_t> deltaExpected;
+  bool deltaMembership = false;
+  if (scenario == "delta") {
+    HersSender *hersSender = static_cast<HersSender*>(sender);
+    cout << "[Sender]\tComputing delta index scenario since epoch 0... " << flush;
+    start = chrono::steady_clock::now();
+    vector<size_t> deltaMatrices;
+    vector<Ciphertext<DCRTPoly>> deltaCipher = hersSender->indexScenario(queryCipher, 0, deltaMatrices);
+    sender->finalizeIndex(deltaCipher);
+    end = chrono::steady_clock::now();
+    duration = end - start;
+    cout << "done (" << duration.count() << "s, " << deltaMatrices.size() << " matrices up to epoch "
+         << hersSender->latestEpoch() << ")" << endl;
+
+    for(size_t i = 0; i < deltaCipher.size(); i++) {
+      vector<size_t> matches = receiver->decryptIndexCipher(deltaCipher[i], deltaMatrices[i]);
+      deltaResults.insert(deltaResults.end(), matches.begin(), matches.end());
+    }
+    for(size_t i = 0; i < indexResults.size(); i++) {
+      if (find(deltaMatrices.begin(), deltaMatrices.end(), indexResults[i] / batchSize) != deltaMatrices.end()) {
+        deltaExpected.push_back(indexResults[i]);
+      }
+    }
+    sort(deltaResults.begin(), deltaResults.end());
+    sort(deltaExpected.begin(), deltaExpected.end());
+
+    Ciphertext<DCRTPoly> deltaMembershipCipher = hersSender->membershipScenario(queryCipher, 0);
+    sender->finalizeMembership(deltaMembershipCipher);
+    deltaMembership = receiver->decryptMembership(deltaMembershipCipher);
+  }
+
   // Displaying query results
   // The dataset-generation script creates datasets of size N with matches at indices 2 and N-1
   cout << endl << "\tDisplaying Query Results:" << endl;
@@ -387,6 +822,66 @@ int main(int argc, char *argv[]) {
   cout << "Index scenario: " << flush;
   cout << indexResults << endl;
   expStream << indexResults << "," << flush;
+  // The argmax decode is checked against the same polynomials simulated on plaintext scores, when the database was read in
+  if (scenario == "argmax" && !READ_FROM_SERIAL) {
+    vector<double> scores = plaintextScores(queryVector, plaintextVectors);
+    vector<size_t> exactResults;
+    size_t best = max_element(scores.begin(), scores.end()) - scores.begin();
+    if (scores[best] >= MATCH_THRESHOLD) {
+      exactResults.push_back(best);
+    }
+    vector<double> simulatedValues = OpenFHEWrapper::simulateArgmax(scores, batchSize);
+    vector<size_t> simulatedResults = OpenFHEWrapper::decodeArgmax(simulatedValues, batchSize, numVectors);
+    cout << "Argmax (plaintext simulation): " << simulatedResults << ", exact: " << exactResults << flush;
+    cout << ((simulatedResults == exactResults) ? " (decoded)" : " (decode mismatch)") << endl;
+  }
+  // Incrementally enrolled galleries are checked against the exact matches of the database, moved to their final indices
+  if (scenario == "incremental") {
+    vector<double> scores = plaintextScores(queryVector, plaintextVectors);
+    vector<size_t> expectedResults;
+    for(size_t k = 0; k < scores.size(); k++) {
+      if (scores[k] >= MATCH_THRESHOLD && finalIndex[k] != SIZE_MAX) {
+        expectedResults.push_back(finalIndex[k]);
+      }
+    }
+    sort(expectedResults.begin(), expectedResults.end());
+    vector<size_t> sortedResults = indexResults;
+    sort(sortedResults.begin(), sortedResults.end());
+    cout << "Incremental gallery: expected " << expectedResults << flush;
+    cout << ((sortedResults == expectedResults) ? " (matched)" : " (mismatch)") << endl;
+  }
+  if (scenario == "delta") {
+    cout << "Delta since epoch 0: " << (deltaMembership ? "true " : "false ") << deltaResults << flush;
+    cout << ", expected " << (deltaExpected.empty() ? "false " : "true ") << deltaExpected << flush;
+    bool deltaMatched = (deltaResults == deltaExpected) && (deltaMembership != deltaExpected.empty());
+    cout << (deltaMatched ? " (matched)" : " (mismatch)") << endl;
+  }
+  if (scenario == "stream" && !streamResults.empty()) {
+    cout << "First streamed match decrypted " << streamFirstMatch.count() << "s after the index scenario started" << endl;
+  }
+  for(size_t t = 0; t < tierResults.size(); t++) {
+    cout << "Tier " << MATCH_TIERS[t] << ": " << (tierMembership[t] ? "true " : "false ") << tierResults[t] << endl;
+  }
+  for(size_t g = 0; g < galleryResults.size(); g++) {
+    cout << watchlistNames[g] << ": " << (galleryMembership[g] ? "true " : "false ") << galleryResults[g] << endl;
+  }
+
+  if (ENABLE_TRACING) {
+    TraceUtils::writeTrace(TRACE_PREFIX + "approach" + to_string(expApproach) + ".json");
+  }
+
+  // Report memory usage of the query phases
+  MemoryUtils::PhaseSample finalSample = MemoryUtils::samplePhase("query complete");
+  MemoryUtils::writeSamples(MEMORY_FILEPATH, memoryLabel + ",query", MemoryUtils::takeSamples());
+  cout << "Key material: " << finalSample.keyBytes / (1024 * 1024) << " MiB" << flush;
+  cout << ", peak ciphertext bytes: " << finalSample.peakCipherBytes / (1024 * 1024) << " MiB" << flush;
+  cout << ", peak RSS: " << finalSample.peakResidentBytes / (1024 * 1024) << " MiB" << endl;
+  if (receiver->encryptionPool() != nullptr) {
+    EncryptionPool::Metrics poolMetrics = receiver->encryptionPool()->metrics();
+    cout << "Encryption pool: depth " << poolMetrics.depth << "/" << poolMetrics.capacity << flush;
+    cout << ", " << poolMetrics.hits << " hits, " << poolMetrics.misses << " misses" << flush;
+    cout << ", refill rate " << poolMetrics.refillRate << " ciphers/s" << endl;
+  }
 
   // Program cleanup
   expStream << endl;
@@ -394,6 +889,7 @@ int main(int argc, char *argv[]) {
 
   delete receiver;
   delete sender;
+  delete multiSender;
 
   cout << endl << "\tProgram successfully terminated" << endl;
   return 0;
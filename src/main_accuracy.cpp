@@ -1,7 +1,9 @@
 // General functionality header files
 #include "../include/config.h"
 #include "../include/vector_utils.h"
+#include "../include/memory_utils.h"
 #include "../include/openFHE_wrapper.h"
+#include "../include/trace_utils.h"
 #include "openfhe.h"
 #include <iostream>
 #include <ctime>
@@ -9,6 +11,7 @@
 // Receiver class header files
 #include "../include/receiver_base.h"
 #include "../include/receiver_blind.h"
+#include "../include/receiver_compact.h"
 #include "../include/receiver_diag.h"
 #include "../include/receiver_grote.h"
 #include "../include/receiver_hers.h"
@@ -22,6 +25,7 @@
 // Sender class header files
 #include "../include/sender_base.h"
 #include "../include/sender_blind.h"
+#include "../include/sender_compact.h"
 #include "../include/sender_diag.h"
 #include "../include/sender_grote.h"
 #include "../include/sender_hers.h"
@@ -45,9 +49,14 @@ int main(int argc, char *argv[]) {
   ifstream fileStream;
   fileStream.open("../test/frgc2-db.dat", ios::in);
 
-  size_t queryIndex;
+  // Query index "all" sweeps every probe against a single setup of the scheme and gallery
+  size_t queryIndex = 0;
+  bool sweepAll = false;
   if (argc > 1) {
-    queryIndex = size_t(atoi(argv[1]));
+    sweepAll = (string(argv[1]) == "all");
+    if (!sweepAll) {
+      queryIndex = size_t(atoi(argv[1]));
+    }
   } else {
     cerr << "Error: query index not included" << endl;
     return 1;
@@ -64,8 +73,8 @@ int main(int argc, char *argv[]) {
     cerr << "Error: approach argument not included" << endl;
     return 1;
   }
-  if (expApproach < 1 || expApproach > 5) {
-    cerr << "Error: approach must be from 1 to 5" << endl;
+  if (expApproach < 1 || expApproach > 6) {
+    cerr << "Error: approach must be from 1 to 6" << endl;
     return 1;
   }
 
@@ -96,29 +105,55 @@ int main(int argc, char *argv[]) {
   }
   idStream.close();
 
+  // Optional "identity" mode enrolls the gallery in per-identity blocks and returns one result per block
+  bool identityMode = (argc > 3 && string(argv[3]) == "identity");
+  if (identityMode && (sweepAll || expApproach < 4)) {
+    cerr << "Error: identity mode requires a single query and the HERS or diagonal approaches" << endl;
+    return 1;
+  }
+  // a serialized gallery holds the plain database order, not the per-identity blocks, and its depth lacks the block sums
+  if (identityMode && READ_FROM_SERIAL) {
+    cerr << "Error: identity mode enrolls its own gallery layout, set READ_FROM_SERIAL to false" << endl;
+    return 1;
+  }
+
   // Compute required multiplicative depth based on approach used
   // Write approach used to stdout and experiment .csv file
   size_t multDepth = OpenFHEWrapper::computeRequiredDepth(expApproach);
+  if (identityMode) {
+    multDepth += OpenFHEWrapper::computeIdentityDepth();
+  }
+  string approachName;
   switch(expApproach) {
     
     case 1:
       cout << "Experimental approach: Literature baseline" << endl;
+      approachName = "Baseline";
       break;
 
     case 2:
       cout << "Experimental approach: GROTE Paper" << endl;
+      approachName = "GROTE";
       break;
 
     case 3:
       cout << "Experimental approach: Blind-Match paper" << endl;
+      approachName = "Blind";
       break;
 
     case 4:
       cout << "Experimental approach: HERS paper" << endl;
+      approachName = "HERS";
       break;
     
     case 5:
       cout << "Experimental approach: Novel diagonal transform" << endl;
+      approachName = "Diagonal";
+      break;
+
+    case 6:
+      cout << "Experimental approach: HERS with server-side query expansion" << endl;
+      approachName = "HERS-Compact";
       break;
   }
 
@@ -235,6 +270,15 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  // Group templates by identity, padding each identity's last block with zero vectors
+  VectorUtils::IdentityLayout layout;
+  if (identityMode) {
+    layout = VectorUtils::identityLayout(databaseID, IDENTITY_BLOCK_LEN);
+    plaintextVectors = VectorUtils::applyIdentityLayout(plaintextVectors, layout);
+    numVectors = plaintextVectors.size();
+    cout << "Identity layout: " << layout.blockIdentity.size() << " blocks of " << IDENTITY_BLOCK_LEN << " slots" << endl;
+  }
+
   if (!READ_FROM_SERIAL) {
 
     cout << "Encrypting database vectors... " << endl;
@@ -242,16 +286,16 @@ int main(int argc, char *argv[]) {
     HersEnroller *enroller;
 
     if (expApproach == 1 || expApproach == 2) {
-      enroller = new BaseEnroller(cc, pk, numVectors);
+      enroller = new BaseEnroller(cc, pk, numVectors, sk);
       static_cast<BaseEnroller*>(enroller)->serializeDB(plaintextVectors);
     } else if (expApproach == 3) {
-      enroller = new BlindEnroller(cc, pk, numVectors);
+      enroller = new BlindEnroller(cc, pk, numVectors, sk);
       static_cast<BlindEnroller*>(enroller)->serializeDB(plaintextVectors, CHUNK_LEN);
-    } else if (expApproach == 4) {
-      enroller = new HersEnroller(cc, pk, numVectors);
+    } else if (expApproach == 4 || expApproach == 6) {
+      enroller = new HersEnroller(cc, pk, numVectors, sk);
       static_cast<HersEnroller*>(enroller)->serializeDB(plaintextVectors);
     } else if (expApproach == 5) {
-      enroller = new DiagonalEnroller(cc, pk, numVectors);
+      enroller = new DiagonalEnroller(cc, pk, numVectors, sk);
       static_cast<DiagonalEnroller*>(enroller)->serializeDB(plaintextVectors);
     }
     delete enroller;
@@ -294,6 +338,10 @@ int main(int argc, char *argv[]) {
   }
   fileStream.close();
 
+  // Report memory usage of setup and enrollment phases
+  string memoryLabel = approachName + "," + to_string(numVectors);
+  MemoryUtils::writeSamples(MEMORY_FILEPATH, memoryLabel + ",enrollment", MemoryUtils::takeSamples());
+
   // Individual-query experiments begin here
   cout << endl << "\tRunning Experiments:" << endl;
   chrono::steady_clock::time_point start, end;
@@ -333,22 +381,187 @@ int main(int argc, char *argv[]) {
       receiver = new DiagonalReceiver(cc, pk, sk, numVectors);
       sender = new DiagonalSender(cc, pk, numVectors);
       break;
+
+    case 6:
+      receiver = new CompactReceiver(cc, pk, sk, numVectors);
+      sender = new CompactSender(cc, pk, numVectors);
+      break;
+  }
+
+  // Multi-probe sweep: raw similarity scores of every probe are decrypted once and thresholded in the clear
+  if (sweepAll) {
+    size_t numQueries = queryVector.size();
+    size_t probeThreads = min(ACCURACY_PARALLEL_PROBES, numQueries);
+    size_t probeCores = max(size_t(1), MAX_NUM_CORES / probeThreads);
+    vector<vector<double>> encryptedScores(numQueries);
+
+    cout << "[Sender]\tComputing similarity scores of " << numQueries << " probes... " << flush;
+    start = chrono::steady_clock::now();
+    omp_set_max_active_levels(2);
+    #pragma omp parallel for num_threads(probeThreads) schedule(dynamic)
+    for (size_t q = 0; q < numQueries; q++) {
+      ThreadBudget::ScopedBudget budget(probeCores);
+      vector<Ciphertext<DCRTPoly>> probeCipher = receiver->encryptQuery(queryVector[q]);
+      vector<Ciphertext<DCRTPoly>> scoreCipher = sender->computeSimilarity(probeCipher);
+      encryptedScores[q] = receiver->decryptScores(scoreCipher);
+    }
+    end = chrono::steady_clock::now();
+    duration = end - start;
+    MemoryUtils::samplePhase("similarity sweep");
+    cout << "done (" << duration.count() << "s)" << endl;
+
+    cout << "[Plaintext]\tComputing unencrypted similarity scores (" << VectorUtils::simdLevel() << ")... " << flush;
+    start = chrono::steady_clock::now();
+    vector<vector<double>> plaintextScores = VectorUtils::plaintextCosineScores(
+      queryVector, VectorUtils::flattenVectors(plaintextVectors, VECTOR_DIM), VECTOR_DIM);
+    end = chrono::steady_clock::now();
+    duration = end - start;
+    cout << "done (" << duration.count() << "s)" << endl;
+
+    // Report counts at the match threshold per probe, split all comparisons into genuine and impostor scores
+    vector<double> encGenuine, encImpostor, plainGenuine, plainImpostor;
+    ofstream accStream;
+    accStream.open("accuracy.csv", ios::app);
+    for (size_t q = 0; q < numQueries; q++) {
+      size_t tp = 0, tn = 0, fp = 0, fn = 0;
+      for (size_t i = 0; i < numVectors; i++) {
+        bool guessPositive = (encryptedScores[q][i] >= MATCH_THRESHOLD);
+        if (queryID[q] == databaseID[i]) {
+          encGenuine.push_back(encryptedScores[q][i]);
+          plainGenuine.push_back(plaintextScores[q][i]);
+          if (guessPositive) {
+            tp += 1;
+          } else {
+            fn += 1;
+          }
+        } else {
+          encImpostor.push_back(encryptedScores[q][i]);
+          plainImpostor.push_back(plaintextScores[q][i]);
+          if (guessPositive) {
+            fp += 1;
+          } else {
+            tn += 1;
+          }
+        }
+      }
+      // counted from raw scores thresholded in the clear, not from the comparison polynomial
+      accStream << q << "," << queryID[q] << ",";
+      accStream << tp << "," << fn << "," << tn << "," << fp << ",score" << endl;
+    }
+    accStream.close();
+
+    sort(encGenuine.begin(), encGenuine.end());
+    sort(encImpostor.begin(), encImpostor.end());
+    sort(plainGenuine.begin(), plainGenuine.end());
+    sort(plainImpostor.begin(), plainImpostor.end());
+
+    // fraction of sorted scores accepted (>= threshold)
+    auto acceptRate = [](const vector<double> &sorted, double threshold) -> double {
+      if (sorted.empty()) {
+        return 0.0;
+      }
+      return double(sorted.end() - lower_bound(sorted.begin(), sorted.end(), threshold)) / double(sorted.size());
+    };
+
+    // TPR / FPR give the ROC curve, FPR / FNR give the DET curve
+    ofstream rocStream;
+    rocStream.open(ROC_FILEPATH, ios::app);
+    double threshold, encTPR, encFPR, plainTPR, plainFPR;
+    for (size_t t = 0; t <= ROC_THRESHOLD_STEPS; t++) {
+      threshold = -1.0 + 2.0 * double(t) / double(ROC_THRESHOLD_STEPS);
+      encTPR = acceptRate(encGenuine, threshold);
+      encFPR = acceptRate(encImpostor, threshold);
+      plainTPR = acceptRate(plainGenuine, threshold);
+      plainFPR = acceptRate(plainImpostor, threshold);
+
+      rocStream << expApproach << "," << threshold << ",";
+      rocStream << encTPR << "," << encFPR << "," << 1.0 - encTPR << ",";
+      rocStream << plainTPR << "," << plainFPR << "," << 1.0 - plainTPR << endl;
+    }
+    rocStream.close();
+
+    cout << "Total comparisons:\t" << numQueries * numVectors << " (" << encGenuine.size() << " genuine)" << endl;
+    cout << "Encrypted TPR / FPR at threshold " << MATCH_THRESHOLD << ":\t"
+         << acceptRate(encGenuine, MATCH_THRESHOLD) << " / " << acceptRate(encImpostor, MATCH_THRESHOLD) << endl;
+    cout << "Unencrypted TPR / FPR at threshold " << MATCH_THRESHOLD << ":\t"
+         << acceptRate(plainGenuine, MATCH_THRESHOLD) << " / " << acceptRate(plainImpostor, MATCH_THRESHOLD) << endl;
+
+    MemoryUtils::samplePhase("query complete");
+    MemoryUtils::writeSamples(MEMORY_FILEPATH, memoryLabel + ",all queries", MemoryUtils::takeSamples());
+
+    delete receiver;
+    delete sender;
+
+    cout << endl << "\tProgram successfully terminated" << endl;
+    return 0;
   }
 
   // Normalize, batch, and encrypt the query vector
+  TraceUtils::beginQuery();
   cout << "[Receiver]\tEncrypting query vector... " << flush;
   start = chrono::steady_clock::now();
   vector<Ciphertext<DCRTPoly>> queryCipher = receiver->encryptQuery(queryVector[queryIndex]);
   end = chrono::steady_clock::now();
   duration = end - start;
+  TraceUtils::recordSpan("query encryption", "phase", start, end);
   cout << "done (" << duration.count() << "s)" << endl;
 
+  if (identityMode) {
+    cout << "[Sender]\tComputing identity scenario... " << flush;
+    start = chrono::steady_clock::now();
+    auto identityCipher = sender->identityScenario(queryCipher, layout.blockLength);
+    sender->finalizeIdentity(identityCipher);
+    end = chrono::steady_clock::now();
+    duration = end - start;
+    TraceUtils::recordSpan("identity computation", "phase", start, end);
+    cout << "done (" << duration.count() << "s, " << identityCipher.size() << " ciphertexts)" << endl;
+
+    cout << "[Receiver]\tDecrypting identity results... " << flush;
+    start = chrono::steady_clock::now();
+    vector<size_t> identityResults = receiver->decryptIdentity(identityCipher, layout.blockIdentity);
+    end = chrono::steady_clock::now();
+    duration = end - start;
+    TraceUtils::recordSpan("identity decryption", "phase", start, end);
+    cout << "done (" << duration.count() << "s)" << endl;
+
+    // identities with any template above the threshold in plaintext
+    vector<double> plaintextScores = VectorUtils::plaintextCosineScores(
+      {queryVector[queryIndex]}, VectorUtils::flattenVectors(plaintextVectors, VECTOR_DIM), VECTOR_DIM)[0];
+    vector<size_t> plaintextIdentities;
+    for (size_t i = 0; i < numVectors; i++) {
+      if (layout.positionTemplate[i] >= 0 && plaintextScores[i] >= MATCH_THRESHOLD) {
+        plaintextIdentities.push_back(layout.blockIdentity[i / layout.blockLength]);
+      }
+    }
+    sort(plaintextIdentities.begin(), plaintextIdentities.end());
+    plaintextIdentities.erase(unique(plaintextIdentities.begin(), plaintextIdentities.end()), plaintextIdentities.end());
+
+    bool encMatched = binary_search(identityResults.begin(), identityResults.end(), queryID[queryIndex]);
+    bool plainMatched = binary_search(plaintextIdentities.begin(), plaintextIdentities.end(), queryID[queryIndex]);
+
+    cout << endl << "\tDisplaying Query Results:" << endl;
+    cout << "Query Subject ID:\t" << queryID[queryIndex] << endl;
+    cout << "Encrypted identities:  \t" << identityResults << "\t(subject " << (encMatched ? "found" : "missed") << ")" << endl;
+    cout << "Unencrypted identities:\t" << plaintextIdentities << "\t(subject " << (plainMatched ? "found" : "missed") << ")" << endl;
+
+    MemoryUtils::samplePhase("query complete");
+    MemoryUtils::writeSamples(MEMORY_FILEPATH, memoryLabel + ",identity query " + to_string(queryIndex), MemoryUtils::takeSamples());
+
+    delete receiver;
+    delete sender;
+
+    cout << endl << "\tProgram successfully terminated" << endl;
+    return 0;
+  }
+
   // Perform index scenario
   cout << "[Sender]\tComputing index scenario... " << flush;
   start = chrono::steady_clock::now();
   auto indexCipher = sender->indexScenario(queryCipher);
+  sender->finalizeIndex(indexCipher);
   end = chrono::steady_clock::now();
   duration = end - start;
+  TraceUtils::recordSpan("index computation", "phase", start, end);
   cout << "done (" << duration.count() << "s)" << endl;
 
   /*
@@ -368,6 +581,7 @@ int main(int argc, char *argv[]) {
   indexResults = receiver->decryptIndex(indexCipher);
   end = chrono::steady_clock::now();
   duration = end - start;
+  TraceUtils::recordSpan("index decryption", "phase", start, end);
   cout << "done (" << duration.count() << "s)" << endl;
 
   // Displaying query results
@@ -376,13 +590,15 @@ int main(int argc, char *argv[]) {
 
   // Accuracy Testing
   vector<double> boolVec = OpenFHEWrapper::decryptVectorToVector(cc, sk, indexCipher);
+  vector<double> plaintextScores = VectorUtils::plaintextCosineScores(
+    {queryVector[queryIndex]}, VectorUtils::flattenVectors(plaintextVectors, VECTOR_DIM), VECTOR_DIM)[0];
   bool isPositive, guessPositive, plaintextPositive;
   size_t tp = 0, tn = 0, fp = 0, fn = 0;
   size_t tpPlain = 0, tnPlain = 0, fpPlain = 0, fnPlain = 0;
   for (size_t i = 0; i < numVectors; i++) {
     isPositive = (queryID[queryIndex] == databaseID[i]);
     guessPositive = (boolVec[i] >= 1.0);
-    plaintextPositive = (VectorUtils::plaintextCosineSim(queryVector[queryIndex], plaintextVectors[i]) >= MATCH_THRESHOLD);
+    plaintextPositive = (plaintextScores[i] >= MATCH_THRESHOLD);
 
     if (isPositive) {
       if (guessPositive) {
@@ -418,10 +634,17 @@ int main(int argc, char *argv[]) {
   cout << "Encrypted true negatives: \t" << tn << "\tUnencrypted true negatives: \t" << tnPlain << endl;
   cout << "Encrypted false positives:\t" << fp << "\tUnencrypted false positives:\t" << fpPlain << endl;
 
+  if (ENABLE_TRACING) {
+    TraceUtils::writeTrace(TRACE_PREFIX + "query" + to_string(queryIndex) + ".json");
+  }
+
+  MemoryUtils::samplePhase("query complete");
+  MemoryUtils::writeSamples(MEMORY_FILEPATH, memoryLabel + ",query " + to_string(queryIndex), MemoryUtils::takeSamples());
+
   ofstream accStream;
   accStream.open("accuracy.csv", ios::app);
   accStream << queryIndex << "," << queryID[queryIndex] << ",";
-  accStream << tp << "," << fn << "," << tn << "," << fp << endl;
+  accStream << tp << "," << fn << "," << tn << "," << fp << ",comparison" << endl;
   accStream.close();
 
   delete receiver;
@@ -0,0 +1,320 @@
+// General functionality header files
+#include "../include/config.h"
+#include "../include/openFHE_wrapper.h"
+#include "../include/thread_budget.h"
+#include "openfhe.h"
+#include <iostream>
+#include <functional>
+#include <random>
+#include <omp.h>
+
+// Sender class header files
+#include "../include/sender_hers.h"
+
+using namespace lbcrypto;
+using namespace std;
+
+// Microbenchmark suite for the OpenFHEWrapper primitives and the alpha-norm kernels of the HERS sender
+// Each primitive is timed on fresh random ciphertexts and its decrypted output is checked against a plaintext reference
+
+// batch sizes, dimensions, comparison depths and thread counts swept by the benchmark
+const vector<size_t> BENCH_BATCH_SIZES({4096, 8192, 16384});
+const vector<size_t> BENCH_DIMENSIONS({64, VECTOR_DIM});
+const vector<size_t> BENCH_SIGN_DEPTHS({7, 10, 13});
+const vector<size_t> BENCH_THREADS({1, 4, 16, MAX_NUM_CORES});
+
+// multiplicative depth of every benchmark context, enough for the deepest comparison
+const size_t BENCH_DEPTH = 16;
+
+// number of input ciphertexts given to the multi-cipher primitives
+const size_t BENCH_NUM_CIPHERS = 8;
+
+// slots within this distance of the threshold are excluded from the comparison error check
+const double COMPARE_BAND = 0.05;
+
+// accepted error of the exact kernels (relative to the largest reference value) and of the comparison
+const double EXACT_TOLERANCE = 1e-3;
+const double COMPARE_TOLERANCE = 0.2;
+
+// exposes the protected alpha-norm kernels of HersSender to the benchmark
+class BenchSender : public HersSender {
+public:
+  using HersSender::HersSender;
+  using HersSender::alphaNormRows;
+  using HersSender::alphaNormColumns;
+};
+
+// plaintext reference of a rotation by factor, matching the sign convention of EvalRotate
+vector<double> rotateReference(const vector<double> &vec, int factor) {
+  int length = vec.size();
+  vector<double> output(length);
+  for(int k = 0; k < length; k++) {
+    output[k] = vec[(((k + factor) % length) + length) % length];
+  }
+  return output;
+}
+
+// times a primitive across all thread counts and appends one row per thread count to the benchmark file
+// kernel must not modify the ciphertexts it captures, the output of its last run is compared against the reference
+// slots where check is false are excluded from the error computation
+void runBenchmark(ofstream &benchStream, CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk,
+                  string primitive, size_t dimension, size_t depth, size_t repetitions, double tolerance,
+                  function<vector<Ciphertext<DCRTPoly>>()> kernel,
+                  vector<double> &reference, vector<bool> check = vector<bool>()) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  chrono::steady_clock::time_point start, end;
+  chrono::duration<double> duration;
+
+  double referenceScale = 1.0;
+  for(double value : reference) {
+    referenceScale = max(referenceScale, abs(value));
+  }
+
+  for(size_t threads : BENCH_THREADS) {
+    ThreadBudget::ScopedBudget budget(threads);
+    omp_set_num_threads(threads);
+
+    vector<double> times(repetitions);
+    vector<Ciphertext<DCRTPoly>> outputCipher;
+    for(size_t r = 0; r < repetitions; r++) {
+      start = chrono::steady_clock::now();
+      outputCipher = kernel();
+      end = chrono::steady_clock::now();
+      duration = end - start;
+      times[r] = duration.count();
+    }
+    sort(times.begin(), times.end());
+    double median = times[repetitions / 2];
+
+    // compare the decrypted output against the plaintext reference
+    vector<double> output = OpenFHEWrapper::decryptVectorToVector(cc, sk, outputCipher);
+    double maxError = 0.0;
+    if(output.size() != reference.size()) {
+      cerr << "Error: " << primitive << " produced " << output.size() << " slots, expected " << reference.size() << endl;
+      maxError = numeric_limits<double>::infinity();
+    } else {
+      for(size_t i = 0; i < output.size(); i++) {
+        if(check.empty() || check[i]) {
+          maxError = max(maxError, abs(output[i] - reference[i]) / referenceScale);
+        }
+      }
+    }
+    bool passed = maxError <= tolerance;
+
+    cout << primitive << "\t(batch = " << batchSize << ", dim = " << dimension << ", depth = " << depth
+         << ", threads = " << threads << ")\t" << median << "s\terror = " << maxError
+         << (passed ? "" : "\tFAILED") << endl;
+
+    benchStream << primitive << "," << batchSize << "," << dimension << "," << depth << ","
+                << threads << "," << repetitions << "," << median << "," << times[0] << ","
+                << maxError << "," << (passed ? "pass" : "fail") << endl;
+  }
+}
+
+// Entry point of the benchmark, optionally restricted to a single primitive
+
+int main(int argc, char *argv[]) {
+
+  // Parse command line args for the number of repetitions and the primitive filter
+  size_t repetitions = 3;
+  if (argc > 1) {
+    repetitions = size_t(atoi(argv[1]));
+  }
+  if (repetitions < 1) {
+    cerr << "Error: number of repetitions must be positive" << endl;
+    return 1;
+  }
+  string filter = (argc > 2) ? string(argv[2]) : "";
+  auto selected = [&filter](string primitive) { return filter.empty() || filter == primitive; };
+
+  // Open benchmark output file
+  ofstream benchStream;
+  benchStream.open(BENCH_FILEPATH, ios::app);
+  if (!benchStream.is_open()) {
+    cerr << "Error: benchmark file not found" << endl;
+    return 1;
+  }
+
+  mt19937 generator(1);
+  uniform_real_distribution<double> distribution(-1.0, 1.0);
+
+  for(size_t batchSize : BENCH_BATCH_SIZES) {
+
+    cout << "\tSetting up CKKS scheme (batch size = " << batchSize << "):" << endl;
+    CCParams<CryptoContextCKKSRNS> parameters;
+    parameters.SetSecurityLevel(HEStd_128_classic);
+    parameters.SetMultiplicativeDepth(BENCH_DEPTH);
+    parameters.SetScalingModSize(45);
+    parameters.SetScalingTechnique(FIXEDMANUAL);
+    parameters.SetBatchSize(batchSize);
+
+    CryptoContext<DCRTPoly> cc = GenCryptoContext(parameters);
+    cc->Enable(PKE);
+    cc->Enable(KEYSWITCH);
+    cc->Enable(LEVELEDSHE);
+    cc->Enable(ADVANCEDSHE);
+
+    auto keyPair = cc->KeyGen();
+    PublicKey<DCRTPoly> pk = keyPair.publicKey;
+    PrivateKey<DCRTPoly> sk = keyPair.secretKey;
+    cc->EvalMultKeyGen(sk);
+    cc->EvalSumKeyGen(sk);
+
+    // binaryRotate decomposes every rotation into positive and negative powers of two
+    vector<int> rotationFactors;
+    for(int i = 1; i < int(batchSize); i *= 2) {
+      rotationFactors.push_back(i);
+      rotationFactors.push_back(-i);
+    }
+    cc->EvalRotateKeyGen(sk, rotationFactors);
+
+    BenchSender sender(cc, pk, batchSize);
+
+    // fresh random inputs for every batch size
+    vector<vector<double>> inputVectors(BENCH_NUM_CIPHERS, vector<double>(batchSize));
+    vector<Ciphertext<DCRTPoly>> inputCipher(BENCH_NUM_CIPHERS);
+    for(size_t i = 0; i < BENCH_NUM_CIPHERS; i++) {
+      for(size_t j = 0; j < batchSize; j++) {
+        inputVectors[i][j] = distribution(generator);
+      }
+      inputCipher[i] = OpenFHEWrapper::encryptFromVector(cc, pk, inputVectors[i]);
+    }
+
+    if (selected("sumAllSlots")) {
+      double sum = 0.0;
+      for(double value : inputVectors[0]) {
+        sum += value;
+      }
+      vector<double> reference(batchSize, sum);
+      runBenchmark(benchStream, cc, sk, "sumAllSlots", 0, 0, repetitions, EXACT_TOLERANCE,
+        [&]() { return vector<Ciphertext<DCRTPoly>>({OpenFHEWrapper::sumAllSlots(cc, inputCipher[0])}); },
+        reference);
+    }
+
+    for(size_t dimension : BENCH_DIMENSIONS) {
+
+      size_t elementsPerCipher = batchSize / dimension;
+
+      // rotates by dimension - 1, the rotation repeatedly applied by mergeSingleCipher
+      if (selected("binaryRotate")) {
+        int factor = dimension - 1;
+        vector<double> reference = rotateReference(inputVectors[0], factor);
+        runBenchmark(benchStream, cc, sk, "binaryRotate", dimension, 0, repetitions, EXACT_TOLERANCE,
+          [&]() { return vector<Ciphertext<DCRTPoly>>({OpenFHEWrapper::binaryRotate(cc, inputCipher[0], factor)}); },
+          reference);
+      }
+
+      // every dimension-th slot packed into the front of the cipher, remaining slots zeroed
+      if (selected("mergeSingleCipher")) {
+        vector<double> reference(batchSize, 0.0);
+        for(size_t j = 0; j < elementsPerCipher; j++) {
+          reference[j] = inputVectors[0][j * dimension];
+        }
+        runBenchmark(benchStream, cc, sk, "mergeSingleCipher", dimension, 0, repetitions, EXACT_TOLERANCE,
+          [&]() {
+            Ciphertext<DCRTPoly> ctxt = inputCipher[0];
+            return vector<Ciphertext<DCRTPoly>>({OpenFHEWrapper::mergeSingleCipher(cc, ctxt, dimension)});
+          },
+          reference);
+      }
+
+      // the merged elements of consecutive ciphers are laid out consecutively across the outputs
+      if (selected("mergeCiphers")) {
+        size_t outputSize = elementsPerCipher * BENCH_NUM_CIPHERS;
+        vector<double> reference(ceil(double(outputSize) / double(batchSize)) * batchSize, 0.0);
+        for(size_t i = 0; i < BENCH_NUM_CIPHERS; i++) {
+          for(size_t j = 0; j < elementsPerCipher; j++) {
+            reference[i * elementsPerCipher + j] = inputVectors[i][j * dimension];
+          }
+        }
+        runBenchmark(benchStream, cc, sk, "mergeCiphers", dimension, 0, repetitions, EXACT_TOLERANCE,
+          [&]() {
+            vector<Ciphertext<DCRTPoly>> ctxts(inputCipher);
+            return OpenFHEWrapper::mergeCiphers(cc, ctxts, dimension);
+          },
+          reference);
+      }
+
+      // the dimension-th slots of cipher i are shifted by (i % dimension) into output cipher (i / dimension)
+      if (selected("compressCiphers")) {
+        size_t ciphersNeeded = ceil(double(BENCH_NUM_CIPHERS) / double(dimension));
+        vector<double> reference(ciphersNeeded * batchSize, 0.0);
+        for(size_t i = 0; i < BENCH_NUM_CIPHERS; i++) {
+          for(size_t k = 0; k < batchSize; k += dimension) {
+            reference[(i / dimension) * batchSize + k + (i % dimension)] = inputVectors[i][k];
+          }
+        }
+        runBenchmark(benchStream, cc, sk, "compressCiphers", dimension, 0, repetitions, EXACT_TOLERANCE,
+          [&]() {
+            vector<Ciphertext<DCRTPoly>> ctxts(inputCipher);
+            return OpenFHEWrapper::compressCiphers(cc, ctxts, dimension);
+          },
+          reference);
+      }
+
+      // row-wise sums of x^(2^alpha + 1) over rows of length dimension, merged in order
+      if (selected("alphaNormRows")) {
+        size_t outputSize = elementsPerCipher * BENCH_NUM_CIPHERS;
+        vector<double> reference(ceil(double(outputSize) / double(batchSize)) * batchSize, 0.0);
+        double power = pow(2.0, ALPHA_DEPTH) + 1.0;
+        for(size_t i = 0; i < BENCH_NUM_CIPHERS; i++) {
+          for(size_t r = 0; r < elementsPerCipher; r++) {
+            for(size_t t = 0; t < dimension; t++) {
+              reference[i * elementsPerCipher + r] += pow(inputVectors[i][r * dimension + t], power);
+            }
+          }
+        }
+        runBenchmark(benchStream, cc, sk, "alphaNormRows", dimension, ALPHA_DEPTH, repetitions, EXACT_TOLERANCE,
+          [&]() {
+            vector<Ciphertext<DCRTPoly>> ctxts(inputCipher);
+            return sender.alphaNormRows(ctxts, ALPHA_DEPTH, dimension);
+          },
+          reference);
+      }
+
+      // column-wise sums of x^(2^alpha + 1) over rows of length dimension, one row of sums per cipher
+      if (selected("alphaNormColumns")) {
+        size_t outputSize = dimension * BENCH_NUM_CIPHERS;
+        vector<double> reference(ceil(double(outputSize) / double(batchSize)) * batchSize, 0.0);
+        double power = pow(2.0, ALPHA_DEPTH) + 1.0;
+        for(size_t i = 0; i < BENCH_NUM_CIPHERS; i++) {
+          for(size_t s = 0; s < batchSize; s++) {
+            reference[i * dimension + (s % dimension)] += pow(inputVectors[i][s], power);
+          }
+        }
+        runBenchmark(benchStream, cc, sk, "alphaNormColumns", dimension, ALPHA_DEPTH, repetitions, EXACT_TOLERANCE,
+          [&]() {
+            vector<Ciphertext<DCRTPoly>> ctxts(inputCipher);
+            return sender.alphaNormColumns(ctxts, ALPHA_DEPTH, dimension);
+          },
+          reference);
+      }
+    }
+
+    // comparison against the match threshold, slots too close to the threshold are not checked
+    if (selected("chebyshevCompare")) {
+      vector<double> reference(batchSize);
+      vector<bool> check(batchSize);
+      for(size_t j = 0; j < batchSize; j++) {
+        reference[j] = (inputVectors[0][j] >= MATCH_THRESHOLD) ? 2.0 : 0.0;
+        check[j] = abs(inputVectors[0][j] - MATCH_THRESHOLD) >= COMPARE_BAND;
+      }
+      for(size_t signDepth : BENCH_SIGN_DEPTHS) {
+        runBenchmark(benchStream, cc, sk, "chebyshevCompare", 0, signDepth, repetitions, COMPARE_TOLERANCE,
+          [&]() {
+            return vector<Ciphertext<DCRTPoly>>({OpenFHEWrapper::chebyshevCompare(cc, inputCipher[0], MATCH_THRESHOLD, signDepth)});
+          },
+          reference, check);
+      }
+    }
+
+    cc->ClearEvalMultKeys();
+    cc->ClearEvalAutomorphismKeys();
+    CryptoContextFactory<DCRTPoly>::ReleaseAllContexts();
+    cout << endl;
+  }
+
+  benchStream.close();
+  return 0;
+}
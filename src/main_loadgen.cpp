@@ -0,0 +1,487 @@
+// Load generator for sustained sender throughput
+// Builds one context and encrypted gallery, then drives a sender through the query scheduler from many client threads
+// Queries are encrypted before the run, so receiver cost is excluded from the reported latencies
+
+// General functionality header files
+#include "../include/config.h"
+#include "../include/vector_utils.h"
+#include "../include/memory_utils.h"
+#include "../include/openFHE_wrapper.h"
+#include "../include/query_pipeline.h"
+#include "../include/query_scheduler.h"
+#include "openfhe.h"
+#include <iostream>
+#include <ctime>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+
+// Receiver class header files
+#include "../include/receiver_base.h"
+#include "../include/receiver_blind.h"
+#include "../include/receiver_compact.h"
+#include "../include/receiver_diag.h"
+#include "../include/receiver_grote.h"
+#include "../include/receiver_hers.h"
+
+// Enroller class header files
+#include "../include/enroller_base.h"
+#include "../include/enroller_blind.h"
+#include "../include/enroller_diag.h"
+#include "../include/enroller_hers.h"
+
+// Sender class header files
+#include "../include/sender_base.h"
+#include "../include/sender_blind.h"
+#include "../include/sender_compact.h"
+#include "../include/sender_diag.h"
+#include "../include/sender_grote.h"
+#include "../include/sender_hers.h"
+
+using namespace lbcrypto;
+using namespace std;
+
+// hands a query to the engine under test, returning false if it is rejected
+typedef function<bool(vector<Ciphertext<DCRTPoly>> &, future<vector<Ciphertext<DCRTPoly>>> &)> SubmitFunction;
+
+// completed and rejected queries of a run, in seconds since the start of the run
+struct LoadSamples {
+  mutex sampleMutex;
+  vector<pair<double, double>> completions;  // completion time and latency
+  vector<double> rejections;
+
+  void complete(double completedAt, double latency) {
+    lock_guard<mutex> lock(sampleMutex);
+    completions.push_back({completedAt, latency});
+  }
+
+  void reject(double rejectedAt) {
+    lock_guard<mutex> lock(sampleMutex);
+    rejections.push_back(rejectedAt);
+  }
+};
+
+// nearest-rank percentile of sorted values
+double percentile(vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  size_t rank = size_t(ceil(p * double(sorted.size())));
+  return sorted[(rank > 0) ? rank - 1 : 0];
+}
+
+// prints and logs throughput and latency percentiles of the queries completed within [intervalStart, intervalEnd)
+// window is "interval" for rows written during the run and "total" for the row covering the whole run
+void reportInterval(LoadSamples &samples, double intervalStart, double intervalEnd, ofstream &expStream, const string &label,
+                    const string &window) {
+
+  vector<double> latencies;
+  size_t rejected = 0;
+  {
+    lock_guard<mutex> lock(samples.sampleMutex);
+    for(size_t i = 0; i < samples.completions.size(); i++) {
+      if (samples.completions[i].first >= intervalStart && samples.completions[i].first < intervalEnd) {
+        latencies.push_back(samples.completions[i].second);
+      }
+    }
+    for(size_t i = 0; i < samples.rejections.size(); i++) {
+      if (samples.rejections[i] >= intervalStart && samples.rejections[i] < intervalEnd) {
+        rejected++;
+      }
+    }
+  }
+  sort(latencies.begin(), latencies.end());
+
+  double throughput = double(latencies.size()) / (intervalEnd - intervalStart);
+  double p50 = percentile(latencies, 0.50);
+  double p95 = percentile(latencies, 0.95);
+  double p99 = percentile(latencies, 0.99);
+
+  cout << "[" << intervalStart << "s, " << intervalEnd << "s)\t" << latencies.size() << " completed, " << rejected
+       << " rejected, " << throughput << " queries/s, latency p50 " << p50 << "s, p95 " << p95 << "s, p99 " << p99
+       << "s" << endl;
+  expStream << label << "," << window << "," << intervalEnd << "," << latencies.size() << "," << rejected << "," << throughput << ","
+            << p50 << "," << p95 << "," << p99 << endl;
+}
+
+// Closed loop: each client submits its next query as soon as its previous one completes
+void runClosedLoop(const SubmitFunction &submit, vector<vector<Ciphertext<DCRTPoly>>> &queryPool, size_t numClients,
+                   chrono::steady_clock::time_point start, chrono::steady_clock::time_point stop, LoadSamples &samples) {
+
+  vector<thread> clients;
+  for(size_t c = 0; c < numClients; c++) {
+    clients.push_back(thread([&, c] {
+      for(size_t k = c; chrono::steady_clock::now() < stop; k += numClients) {
+        chrono::steady_clock::time_point submitted = chrono::steady_clock::now();
+        future<vector<Ciphertext<DCRTPoly>>> result;
+        if (!submit(queryPool[k % queryPool.size()], result)) {
+          samples.reject(chrono::duration<double>(submitted - start).count());
+          this_thread::sleep_for(chrono::milliseconds(LOADGEN_POLL_MS));
+          continue;
+        }
+        result.get();
+        chrono::steady_clock::time_point completed = chrono::steady_clock::now();
+        samples.complete(chrono::duration<double>(completed - start).count(),
+                         chrono::duration<double>(completed - submitted).count());
+      }
+    }));
+  }
+  for(size_t c = 0; c < numClients; c++) {
+    clients[c].join();
+  }
+}
+
+// Open loop: queries arrive as a Poisson process of the given rate, independently of earlier completions
+// a collector polls outstanding queries so that each latency is taken when its own result is ready
+void runPoissonLoop(const SubmitFunction &submit, vector<vector<Ciphertext<DCRTPoly>>> &queryPool, double arrivalRate,
+                    chrono::steady_clock::time_point start, chrono::steady_clock::time_point stop, LoadSamples &samples) {
+
+  typedef pair<chrono::steady_clock::time_point, future<vector<Ciphertext<DCRTPoly>>>> Outstanding;
+  mutex outstandingMutex;
+  list<Outstanding> outstanding;
+  atomic<bool> dispatching(true);
+
+  thread collector([&] {
+    while (true) {
+      bool done = !dispatching;
+      {
+        lock_guard<mutex> lock(outstandingMutex);
+        for(list<Outstanding>::iterator it = outstanding.begin(); it != outstanding.end();) {
+          if (it->second.wait_for(chrono::seconds(0)) != future_status::ready) {
+            it++;
+            continue;
+          }
+          it->second.get();
+          chrono::steady_clock::time_point completed = chrono::steady_clock::now();
+          samples.complete(chrono::duration<double>(completed - start).count(),
+                           chrono::duration<double>(completed - it->first).count());
+          it = outstanding.erase(it);
+        }
+        if (done && outstanding.empty()) {
+          break;
+        }
+      }
+      this_thread::sleep_for(chrono::milliseconds(LOADGEN_POLL_MS));
+    }
+  });
+
+  mt19937_64 generator(random_device{}());
+  exponential_distribution<double> interarrival(arrivalRate);
+  chrono::steady_clock::time_point arrival = start;
+  for(size_t k = 0; ; k++) {
+    arrival += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(interarrival(generator)));
+    if (arrival >= stop) {
+      break;
+    }
+    this_thread::sleep_until(arrival);
+
+    future<vector<Ciphertext<DCRTPoly>>> result;
+    if (!submit(queryPool[k % queryPool.size()], result)) {
+      samples.reject(chrono::duration<double>(arrival - start).count());
+      continue;
+    }
+    lock_guard<mutex> lock(outstandingMutex);
+    outstanding.push_back(Outstanding(arrival, move(result)));
+  }
+  dispatching = false;
+  collector.join();
+}
+
+Sender *createSender(size_t approach, CryptoContext<DCRTPoly> cc, PublicKey<DCRTPoly> pk, size_t numVectors) {
+  switch(approach) {
+    case 1:
+      return new BaseSender(cc, pk, numVectors);
+    case 2:
+      return new GroteSender(cc, pk, numVectors);
+    case 3:
+      return new BlindSender(cc, pk, numVectors);
+    case 4:
+      return new HersSender(cc, pk, numVectors);
+    case 5:
+      return new DiagonalSender(cc, pk, numVectors);
+    default:
+      return new CompactSender(cc, pk, numVectors);
+  }
+}
+
+// encrypts the gallery in the layout of the approach below root
+void enrollGallery(size_t approach, CryptoContext<DCRTPoly> cc, PublicKey<DCRTPoly> pk, PrivateKey<DCRTPoly> sk,
+                   vector<vector<double>> &plaintextVectors, const string &root) {
+  if (approach == 1 || approach == 2) {
+    BaseEnroller enroller(cc, pk, plaintextVectors.size(), sk);
+    enroller.setSerialRoot(root);
+    enroller.serializeDB(plaintextVectors);
+  } else if (approach == 3) {
+    BlindEnroller enroller(cc, pk, plaintextVectors.size(), sk);
+    enroller.setSerialRoot(root);
+    enroller.serializeDB(plaintextVectors, CHUNK_LEN);
+  } else if (approach == 5) {
+    DiagonalEnroller enroller(cc, pk, plaintextVectors.size(), sk);
+    enroller.setSerialRoot(root);
+    enroller.serializeDB(plaintextVectors);
+  } else {
+    HersEnroller enroller(cc, pk, plaintextVectors.size(), sk);
+    enroller.setSerialRoot(root);
+    enroller.serializeDB(plaintextVectors);
+  }
+}
+
+// Entry point of the load generator
+
+int main(int argc, char *argv[]) {
+
+  cout << "\tRunning Setup Operations:" << endl;
+
+  // Parse command line arg for experimental vector dataset
+  ifstream fileStream;
+  if (argc > 1) {
+    fileStream.open(argv[1], ios::in);
+  } else {
+    cerr << "Error: input file not included" << endl;
+    return 1;
+  }
+  if (!fileStream.is_open()) {
+    cerr << "Error: unable to open input file" << endl;
+    return 1;
+  }
+  size_t numVectors;
+  fileStream >> numVectors;
+
+  // Parse command line args for approach, load mode, load level, run duration and engine
+  size_t expApproach = 5;
+  if (argc > 2) {
+    expApproach = atoi(argv[2]);
+  }
+  if (expApproach < 1 || expApproach > 6) {
+    cerr << "Error: approach must be from 1 to 6" << endl;
+    return 1;
+  }
+  string mode = "closed";
+  if (argc > 3) {
+    mode = argv[3];
+  }
+  if (mode != "closed" && mode != "poisson") {
+    cerr << "Error: mode must be \"closed\" or \"poisson\"" << endl;
+    return 1;
+  }
+  double load = (mode == "closed") ? double(SCHEDULER_WORKERS) : 1.0;
+  if (argc > 4) {
+    load = atof(argv[4]);
+  }
+  if (load <= 0.0) {
+    cerr << "Error: number of clients or arrival rate must be positive" << endl;
+    return 1;
+  }
+  double runDuration = LOADGEN_DURATION_S;
+  if (argc > 5) {
+    runDuration = atof(argv[5]);
+  }
+  string engine = "scheduler";
+  if (argc > 6) {
+    engine = argv[6];
+  }
+  if (engine != "scheduler" && engine != "pipeline") {
+    cerr << "Error: engine must be \"scheduler\" or \"pipeline\"" << endl;
+    return 1;
+  }
+
+  // Open load generator experiment-tracking file
+  ofstream expStream;
+  expStream.open(LOADGEN_FILEPATH, ios::app);
+  if (!expStream.is_open()) {
+    cerr << "Error: experiment file not found" << endl;
+    return 1;
+  }
+
+  // Generate the scheme context and keys
+  size_t multDepth = OpenFHEWrapper::computeRequiredDepth(expApproach);
+  CCParams<CryptoContextCKKSRNS> parameters;
+  parameters.SetSecurityLevel(HEStd_128_classic);
+  parameters.SetMultiplicativeDepth(multDepth);
+  parameters.SetScalingModSize(45);
+  parameters.SetScalingTechnique(FIXEDMANUAL);
+
+  CryptoContext<DCRTPoly> cc = GenCryptoContext(parameters);
+  cc->Enable(PKE);
+  cc->Enable(KEYSWITCH);
+  cc->Enable(LEVELEDSHE);
+  cc->Enable(ADVANCEDSHE);
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+
+  cout << "Generating keys... " << endl;
+  auto keyPair = cc->KeyGen();
+  PublicKey<DCRTPoly> pk = keyPair.publicKey;
+  PrivateKey<DCRTPoly> sk = keyPair.secretKey;
+  cc->EvalMultKeyGen(sk);
+  cc->EvalSumKeyGen(sk);
+  vector<int> rotationFactors(VECTOR_DIM-1);
+  iota(rotationFactors.begin(), rotationFactors.end(), 1);
+  for(int i = VECTOR_DIM; i < int(batchSize); i *= 2) {
+    rotationFactors.push_back(i);
+  }
+  for(int i = 1; i < int(batchSize); i *= 2) {
+    rotationFactors.push_back(-i);
+  }
+  cc->EvalRotateKeyGen(sk, rotationFactors);
+  cout << "CKKS scheme set up (depth = " << multDepth << ", batch size = " << batchSize << ")" << endl;
+
+  // Read in query and database vectors from file
+  vector<double> queryVector(VECTOR_DIM);
+  for (size_t i = 0; i < VECTOR_DIM; i++) {
+    fileStream >> queryVector[i];
+  }
+  vector<vector<double>> plaintextVectors(numVectors, vector<double>(VECTOR_DIM));
+  for (size_t i = 0; i < numVectors; i++) {
+    for (size_t j = 0; j < VECTOR_DIM; j++) {
+      fileStream >> plaintextVectors[i][j];
+    }
+  }
+  fileStream.close();
+
+  cout << "Encrypting database vectors... " << endl;
+  Receiver *receiver;
+  string approachName;
+  enrollGallery(expApproach, cc, pk, sk, plaintextVectors, SERIAL_ROOT);
+  Sender *sender = createSender(expApproach, cc, pk, numVectors);
+  switch(expApproach) {
+
+    case 1:
+      receiver = new BaseReceiver(cc, pk, sk, numVectors);
+      approachName = "Baseline";
+      break;
+
+    case 2:
+      receiver = new GroteReceiver(cc, pk, sk, numVectors);
+      approachName = "GROTE";
+      break;
+
+    case 3:
+      receiver = new BlindReceiver(cc, pk, sk, numVectors);
+      approachName = "Blind";
+      break;
+
+    case 4:
+      receiver = new HersReceiver(cc, pk, sk, numVectors);
+      approachName = "HERS";
+      break;
+
+    case 5:
+      receiver = new DiagonalReceiver(cc, pk, sk, numVectors);
+      approachName = "Diagonal";
+      break;
+
+    default:
+      receiver = new CompactReceiver(cc, pk, sk, numVectors);
+      approachName = "HERS-Compact";
+      break;
+  }
+
+  // Pre-encrypt a pool of distinct queries: the query vector of the file followed by gallery vectors
+  cout << "Encrypting " << LOADGEN_QUERY_POOL << " queries... " << endl;
+  vector<vector<Ciphertext<DCRTPoly>>> queryPool(LOADGEN_QUERY_POOL);
+  for(size_t k = 0; k < LOADGEN_QUERY_POOL; k++) {
+    vector<double> &poolVector = (k == 0 || numVectors == 0) ? queryVector : plaintextVectors[(k - 1) % numVectors];
+    queryPool[k] = receiver->encryptQuery(poolVector);
+  }
+
+  // A second gallery version is enrolled up front and swapped in LOADGEN_SWAP_AT_S seconds into a scheduler run
+  bool hotSwap = (engine == "scheduler" && LOADGEN_SWAP_AT_S > 0.0 && LOADGEN_SWAP_AT_S < runDuration);
+  if (hotSwap) {
+    cout << "Encrypting database vectors for the swapped-in gallery version... " << endl;
+    enrollGallery(expApproach, cc, pk, sk, plaintextVectors, GalleryManager::versionRoot(1));
+  }
+  plaintextVectors.clear();
+
+  // The scheduler evaluates whole queries on concurrent workers, the pipeline overlaps the stages of consecutive queries
+  GalleryManager *galleries = nullptr;
+  QueryScheduler *scheduler = nullptr;
+  QueryPipeline *pipeline = nullptr;
+  SubmitFunction submit;
+  if (engine == "scheduler") {
+    galleries = new GalleryManager(cc, pk, [expApproach](CryptoContext<DCRTPoly> cc, PublicKey<DCRTPoly> pk, size_t numVectors) {
+      return createSender(expApproach, cc, pk, numVectors);
+    }, SERIAL_ROOT, numVectors);
+    scheduler = new QueryScheduler(galleries, QueryScheduler::Options());
+    submit = [scheduler](vector<Ciphertext<DCRTPoly>> &queryCipher, future<vector<Ciphertext<DCRTPoly>>> &result) {
+      return scheduler->submit(queryCipher, QueryScheduler::INDEX, QueryScheduler::NO_DEADLINE, result);
+    };
+  } else {
+    pipeline = new QueryPipeline(sender);
+    submit = [pipeline](vector<Ciphertext<DCRTPoly>> &queryCipher, future<vector<Ciphertext<DCRTPoly>>> &result) {
+      result = pipeline->submit(queryCipher);
+      return true;
+    };
+  }
+  cout << endl << "\tRunning " << approachName << " on the query " << engine << " under " << mode << " load (" << load
+       << ((mode == "closed") ? " clients" : " queries/s") << ", " << runDuration << "s):" << endl;
+
+  // Report every interval while the run is in progress, and the queries drained after the run at the end
+  ostringstream labelStream;
+  labelStream << approachName << "," << numVectors << "," << engine << "," << mode << "," << load;
+  string label = labelStream.str();
+  LoadSamples samples;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  chrono::steady_clock::time_point stop = start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                                      chrono::duration<double>(runDuration));
+  atomic<bool> running(true);
+  thread reporter([&] {
+    for(double intervalEnd = LOADGEN_REPORT_INTERVAL_S; intervalEnd <= runDuration; intervalEnd += LOADGEN_REPORT_INTERVAL_S) {
+      this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(intervalEnd)));
+      if (!running) {
+        break;
+      }
+      reportInterval(samples, intervalEnd - LOADGEN_REPORT_INTERVAL_S, intervalEnd, expStream, label, "interval");
+    }
+  });
+
+  thread swapper;
+  if (hotSwap) {
+    swapper = thread([&] {
+      this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(LOADGEN_SWAP_AT_S)));
+      cout << "Swapping in gallery version 1 at " << chrono::duration<double>(chrono::steady_clock::now() - start).count()
+           << "s" << endl;
+      galleries->stage(GalleryManager::versionRoot(1), numVectors);
+      galleries->waitForSwap();
+    });
+  }
+
+  if (mode == "closed") {
+    runClosedLoop(submit, queryPool, size_t(load), start, stop, samples);
+  } else {
+    runPoissonLoop(submit, queryPool, load, start, stop, samples);
+  }
+  running = false;
+  reporter.join();
+  if (swapper.joinable()) {
+    swapper.join();
+  }
+  double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  cout << endl << "\tDisplaying Load Results:" << endl;
+  reportInterval(samples, 0.0, elapsed, expStream, label, "total");
+  if (scheduler != nullptr) {
+    QueryScheduler::Metrics metrics = scheduler->metrics();
+    cout << "Scheduler: " << metrics.admitted << " admitted, " << metrics.rejected << " rejected, " << metrics.batches
+         << " batches, mean wait " << metrics.meanWait << "s, mean service " << metrics.meanService << "s" << endl;
+  } else {
+    // busy time above elapsed time in both stages means consecutive queries overlapped
+    QueryPipeline::Metrics metrics = pipeline->metrics();
+    cout << "Pipeline: " << metrics.completed << " completed, similarity busy " << metrics.similarityBusy
+         << "s, comparison busy " << metrics.comparisonBusy << "s over " << elapsed << "s, mean latency "
+         << metrics.meanLatency << "s" << endl;
+  }
+  expStream.close();
+
+  delete scheduler;
+  delete galleries;
+  delete pipeline;
+  delete receiver;
+  delete sender;
+
+  cout << endl << "\tProgram successfully terminated" << endl;
+  return 0;
+}
\ No newline at end of file
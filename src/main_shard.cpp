@@ -0,0 +1,352 @@
+// Sharded deployment of the HERS, diagonal and HERS-Compact approaches
+// A coordinator splits the gallery matrices across worker processes, each serving its own serial store,
+// fans the encrypted query out to them and combines their encrypted results for the receiver
+
+// General functionality header files
+#include "../include/config.h"
+#include "../include/vector_utils.h"
+#include "../include/memory_utils.h"
+#include "../include/openFHE_wrapper.h"
+#include "../include/thread_budget.h"
+#include "openfhe.h"
+#include <iostream>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Receiver, enroller and sender class header files
+#include "../include/receiver_compact.h"
+#include "../include/receiver_diag.h"
+#include "../include/receiver_hers.h"
+#include "../include/enroller_diag.h"
+#include "../include/enroller_hers.h"
+#include "../include/sender_compact.h"
+#include "../include/sender_diag.h"
+#include "../include/sender_hers.h"
+
+// Header files needed for serialization
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+using namespace lbcrypto;
+using namespace std;
+
+// serial store of a single shard, below the shared context and keys in SERIAL_ROOT
+string shardRoot(size_t shard) {
+  return SERIAL_ROOT + "shard" + to_string(shard) + "/";
+}
+
+Sender *createSender(size_t approach, CryptoContext<DCRTPoly> cc, PublicKey<DCRTPoly> pk, size_t numVectors) {
+  if (approach == 5) {
+    return new DiagonalSender(cc, pk, numVectors);
+  }
+  if (approach == 6) {
+    return new CompactSender(cc, pk, numVectors);
+  }
+  return new HersSender(cc, pk, numVectors);
+}
+
+// Worker process: answers the query in SERIAL_ROOT against its own shard
+// Membership is left unfinalized, as its bound only holds once all shards are summed by the coordinator
+int runWorker(size_t approach, size_t shard, size_t shardVectors, size_t numCores) {
+
+  ThreadBudget::setCores(numCores);
+
+  CryptoContext<DCRTPoly> cc;
+  PublicKey<DCRTPoly> pk;
+  if (!OpenFHEWrapper::deserializeContext(cc, pk, SERIAL_ROOT)) {
+    return 1;
+  }
+
+  vector<Ciphertext<DCRTPoly>> queryCipher;
+  if (!Serial::DeserializeFromFile(SERIAL_ROOT + "query.bin", queryCipher, SerType::BINARY)) {
+    cerr << "Error: shard " << shard << " cannot deserialize the query" << endl;
+    return 1;
+  }
+
+  Sender *sender = createSender(approach, cc, pk, shardVectors);
+  sender->setSerialRoot(shardRoot(shard));
+
+  Ciphertext<DCRTPoly> membershipCipher = sender->membershipScenario(queryCipher);
+  vector<Ciphertext<DCRTPoly>> indexCipher = sender->indexScenario(queryCipher);
+  sender->finalizeIndex(indexCipher);
+  delete sender;
+
+  if (!Serial::SerializeToFile(shardRoot(shard) + "membership.bin", membershipCipher, SerType::BINARY)
+      || !Serial::SerializeToFile(shardRoot(shard) + "index.bin", indexCipher, SerType::BINARY)) {
+    cerr << "Error: shard " << shard << " cannot serialize its results" << endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+// Entry point of the coordinator, or of a worker when started with --worker by the coordinator
+
+int main(int argc, char *argv[]) {
+
+  if (argc > 1 && string(argv[1]) == "--worker") {
+    if (argc < 6) {
+      cerr << "Error: workers require an approach, shard, shard size and core count" << endl;
+      return 1;
+    }
+    return runWorker(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+  }
+
+  cout << "\tRunning Setup Operations:" << endl;
+
+  // Parse command line arg for experimental vector dataset
+  ifstream fileStream;
+  if (argc > 1) {
+    fileStream.open(argv[1], ios::in);
+  } else {
+    cerr << "Error: input file not included" << endl;
+    return 1;
+  }
+  if (!fileStream.is_open()) {
+    cerr << "Error: unable to open input file" << endl;
+    return 1;
+  }
+  size_t numVectors;
+  fileStream >> numVectors;
+
+  // Parse command line args for experimental approach and number of shards
+  size_t expApproach = 5;
+  if (argc > 2) {
+    expApproach = atoi(argv[2]);
+  }
+  if (expApproach < 4 || expApproach > 6) {
+    cerr << "Error: sharding requires the HERS, diagonal or HERS-Compact approach (4 to 6)" << endl;
+    return 1;
+  }
+  size_t numShards = 2;
+  if (argc > 3) {
+    numShards = atoi(argv[3]);
+  }
+  if (numShards < 1) {
+    cerr << "Error: number of shards must be positive" << endl;
+    return 1;
+  }
+
+  // Open shard experiment-tracking file
+  ofstream expStream;
+  expStream.open(SHARD_FILEPATH, ios::app);
+  if (!expStream.is_open()) {
+    cerr << "Error: experiment file not found" << endl;
+    return 1;
+  }
+
+  // Generate the scheme context and keys, shared by the coordinator and all workers
+  size_t multDepth = OpenFHEWrapper::computeRequiredDepth(expApproach);
+  CCParams<CryptoContextCKKSRNS> parameters;
+  parameters.SetSecurityLevel(HEStd_128_classic);
+  parameters.SetMultiplicativeDepth(multDepth);
+  parameters.SetScalingModSize(45);
+  parameters.SetScalingTechnique(FIXEDMANUAL);
+
+  CryptoContext<DCRTPoly> cc = GenCryptoContext(parameters);
+  cc->Enable(PKE);
+  cc->Enable(KEYSWITCH);
+  cc->Enable(LEVELEDSHE);
+  cc->Enable(ADVANCEDSHE);
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+
+  cout << "Generating keys... " << endl;
+  auto keyPair = cc->KeyGen();
+  PublicKey<DCRTPoly> pk = keyPair.publicKey;
+  PrivateKey<DCRTPoly> sk = keyPair.secretKey;
+  cc->EvalMultKeyGen(sk);
+  cc->EvalSumKeyGen(sk);
+  vector<int> rotationFactors(VECTOR_DIM-1);
+  iota(rotationFactors.begin(), rotationFactors.end(), 1);
+  for(int i = VECTOR_DIM; i < int(batchSize); i *= 2) {
+    rotationFactors.push_back(i);
+  }
+  for(int i = 1; i < int(batchSize); i *= 2) {
+    rotationFactors.push_back(-i);
+  }
+  cc->EvalRotateKeyGen(sk, rotationFactors);
+  cout << "CKKS scheme set up (depth = " << multDepth << ", batch size = " << batchSize << ")" << endl;
+
+  if (!filesystem::exists(SERIAL_ROOT) && !filesystem::create_directories(SERIAL_ROOT)) {
+    cerr << "Error: Failed to create directory \"" + SERIAL_ROOT + "\"" << endl;
+    return 1;
+  }
+  if (!OpenFHEWrapper::serializeContext(cc, pk, SERIAL_ROOT)) {
+    return 1;
+  }
+
+  // Partition whole matrices across shards so that every shard keeps the flat slot layout
+  size_t numMatrices = ceil(double(numVectors) / double(batchSize));
+  if (numShards > numMatrices) {
+    cout << "Only " << numMatrices << " matrices to shard, using " << numMatrices << " shards" << endl;
+    numShards = numMatrices;
+  }
+  vector<size_t> shardMatrix(numShards + 1);
+  for(size_t s = 0; s <= numShards; s++) {
+    shardMatrix[s] = s * numMatrices / numShards;
+  }
+
+  // Read in query and database vectors from file
+  vector<double> queryVector(VECTOR_DIM);
+  for (size_t i = 0; i < VECTOR_DIM; i++) {
+    fileStream >> queryVector[i];
+  }
+  vector<vector<double>> plaintextVectors(numVectors, vector<double>(VECTOR_DIM));
+  for (size_t i = 0; i < numVectors; i++) {
+    for (size_t j = 0; j < VECTOR_DIM; j++) {
+      fileStream >> plaintextVectors[i][j];
+    }
+  }
+  fileStream.close();
+
+  // Enroll each shard into its own serial store
+  chrono::steady_clock::time_point start, end;
+  chrono::duration<double> duration;
+  vector<size_t> shardVectors(numShards);
+  cout << "Encrypting database vectors into " << numShards << " shards... " << flush;
+  start = chrono::steady_clock::now();
+  for(size_t s = 0; s < numShards; s++) {
+    size_t first = shardMatrix[s] * batchSize;
+    size_t last = min(shardMatrix[s + 1] * batchSize, numVectors);
+    vector<vector<double>> shardDatabase(plaintextVectors.begin() + first, plaintextVectors.begin() + last);
+    shardVectors[s] = last - first;
+
+    if (expApproach == 5) {
+      DiagonalEnroller enroller(cc, pk, shardVectors[s], sk);
+      enroller.setSerialRoot(shardRoot(s));
+      enroller.serializeDB(shardDatabase);
+    } else {
+      HersEnroller enroller(cc, pk, shardVectors[s], sk);
+      enroller.setSerialRoot(shardRoot(s));
+      enroller.serializeDB(shardDatabase);
+    }
+  }
+  end = chrono::steady_clock::now();
+  duration = end - start;
+  cout << "done (" << duration.count() << "s)" << endl;
+  plaintextVectors.clear();
+
+  cout << endl << "\tRunning Experiments:" << endl;
+
+  // owned by a unique_ptr, as every failed shard returns early
+  unique_ptr<Receiver> receiver;
+  if (expApproach == 5) {
+    receiver.reset(new DiagonalReceiver(cc, pk, sk, numVectors));
+  } else if (expApproach == 6) {
+    receiver.reset(new CompactReceiver(cc, pk, sk, numVectors));
+  } else {
+    receiver.reset(new HersReceiver(cc, pk, sk, numVectors));
+  }
+
+  cout << "[Receiver]\tEncrypting query vector... " << flush;
+  start = chrono::steady_clock::now();
+  vector<Ciphertext<DCRTPoly>> queryCipher = receiver->encryptQuery(queryVector);
+  end = chrono::steady_clock::now();
+  duration = end - start;
+  cout << "done (" << duration.count() << "s)" << endl;
+  expStream << expApproach << "," << numVectors << "," << numShards << "," << flush;
+  expStream << duration.count() << "," << flush;
+
+  // Fan the query out to one worker process per shard, splitting the cores of this machine between them
+  cout << "[Coordinator]\tComputing results on " << numShards << " shards... " << flush;
+  start = chrono::steady_clock::now();
+  if (!Serial::SerializeToFile(SERIAL_ROOT + "query.bin", queryCipher, SerType::BINARY)) {
+    cerr << "Error: cannot serialize the query" << endl;
+    return 1;
+  }
+  size_t workerCores = max(size_t(1), MAX_NUM_CORES / numShards);
+  vector<pid_t> workers(numShards);
+  for(size_t s = 0; s < numShards; s++) {
+    vector<string> args({argv[0], "--worker", to_string(expApproach), to_string(s), to_string(shardVectors[s]),
+                         to_string(workerCores)});
+    vector<char *> argPointers;
+    for(size_t i = 0; i < args.size(); i++) {
+      argPointers.push_back(&args[i][0]);
+    }
+    argPointers.push_back(nullptr);
+
+    // argv[0] need not be a path when started through PATH, so the worker image is taken from /proc
+    workers[s] = fork();
+    if (workers[s] == 0) {
+      execv("/proc/self/exe", argPointers.data());
+      _exit(127);
+    }
+    if (workers[s] < 0) {
+      cerr << "Error: cannot start worker for shard " << s << endl;
+      return 1;
+    }
+  }
+  bool workersSucceeded = true;
+  for(size_t s = 0; s < numShards; s++) {
+    int status;
+    waitpid(workers[s], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      cerr << "Error: worker for shard " << s << " failed" << endl;
+      workersSucceeded = false;
+    }
+  }
+  if (!workersSucceeded) {
+    return 1;
+  }
+  end = chrono::steady_clock::now();
+  duration = end - start;
+  cout << "done (" << duration.count() << "s)" << endl;
+  expStream << duration.count() << "," << flush;
+
+  // Sum membership results homomorphically and concatenate index results in shard order
+  // offset map records the global position of every shard's first index cipher
+  cout << "[Coordinator]\tCombining shard results... " << flush;
+  start = chrono::steady_clock::now();
+  Ciphertext<DCRTPoly> membershipCipher;
+  vector<Ciphertext<DCRTPoly>> indexCipher;
+  vector<size_t> cipherOffset;
+  for(size_t s = 0; s < numShards; s++) {
+    Ciphertext<DCRTPoly> shardMembership;
+    vector<Ciphertext<DCRTPoly>> shardIndex;
+    if (!Serial::DeserializeFromFile(shardRoot(s) + "membership.bin", shardMembership, SerType::BINARY)
+        || !Serial::DeserializeFromFile(shardRoot(s) + "index.bin", shardIndex, SerType::BINARY)) {
+      cerr << "Error: cannot deserialize the results of shard " << s << endl;
+      return 1;
+    }
+
+    membershipCipher = (s == 0) ? shardMembership : cc->EvalAdd(membershipCipher, shardMembership);
+    for(size_t i = 0; i < shardIndex.size(); i++) {
+      indexCipher.push_back(shardIndex[i]);
+      cipherOffset.push_back(shardMatrix[s] + i);
+    }
+  }
+  OpenFHEWrapper::finalizeResponse(cc, membershipCipher, 2.0 * numVectors);
+  end = chrono::steady_clock::now();
+  duration = end - start;
+  cout << "done (" << duration.count() << "s)" << endl;
+  expStream << duration.count() << "," << flush;
+
+  cout << "[Receiver]\tDecrypting results... " << flush;
+  start = chrono::steady_clock::now();
+  bool membershipResult = receiver->decryptMembership(membershipCipher);
+  vector<size_t> indexResults;
+  for(size_t i = 0; i < indexCipher.size(); i++) {
+    vector<size_t> matches = receiver->decryptIndexCipher(indexCipher[i], cipherOffset[i]);
+    indexResults.insert(indexResults.end(), matches.begin(), matches.end());
+  }
+  end = chrono::steady_clock::now();
+  duration = end - start;
+  cout << "done (" << duration.count() << "s)" << endl;
+  expStream << duration.count() << "," << flush;
+
+  cout << endl << "\tDisplaying Query Results:" << endl;
+  cout << "Membership scenario: " << (membershipResult ? "true" : "false") << endl;
+  expStream << (membershipResult ? "true" : "false") << "," << flush;
+  cout << "Index scenario: " << indexResults << endl;
+  expStream << indexResults << endl;
+  expStream.close();
+
+  cout << endl << "\tProgram successfully terminated" << endl;
+  return 0;
+}
\ No newline at end of file
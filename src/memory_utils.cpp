@@ -0,0 +1,191 @@
+#include "../include/memory_utils.h"
+
+namespace {
+
+atomic<size_t> liveCipherBytes(0);
+atomic<size_t> peakCipherBytes(0);
+atomic<size_t> livePlaintextBytes(0);
+atomic<size_t> peakPlaintextBytes(0);
+
+mutex sampleMutex;
+vector<MemoryUtils::PhaseSample> phaseSamples;
+
+void updatePeak(atomic<size_t> &peak, size_t value) {
+  size_t current = peak.load();
+  while (value > current && !peak.compare_exchange_weak(current, value)) {
+  }
+}
+
+// reads a "<field>:   <value> kB" line from /proc/self/status, returns bytes (0 if unavailable)
+size_t readStatusField(const string &field) {
+  ifstream statusStream("/proc/self/status", ios::in);
+  string line;
+  while (getline(statusStream, line)) {
+    if (line.compare(0, field.size(), field) == 0) {
+      return stoull(line.substr(field.size() + 1)) * 1024;
+    }
+  }
+  return 0;
+}
+
+}
+
+size_t MemoryUtils::polyBytes(const DCRTPoly &poly) {
+  return size_t(poly.GetNumOfElements()) * size_t(poly.GetRingDimension()) * sizeof(uint64_t);
+}
+
+
+size_t MemoryUtils::cipherBytes(const Ciphertext<DCRTPoly> &ctxt) {
+  if (!ctxt) {
+    return 0;
+  }
+  size_t bytes = 0;
+  for (const auto &element : ctxt->GetElements()) {
+    bytes += polyBytes(element);
+  }
+  return bytes;
+}
+
+
+size_t MemoryUtils::cipherBytes(const vector<Ciphertext<DCRTPoly>> &ctxts) {
+  size_t bytes = 0;
+  for (const auto &ctxt : ctxts) {
+    bytes += cipherBytes(ctxt);
+  }
+  return bytes;
+}
+
+
+size_t MemoryUtils::plaintextBytes(const Plaintext &ptxt) {
+  if (!ptxt) {
+    return 0;
+  }
+  return polyBytes(ptxt->GetElement<DCRTPoly>());
+}
+
+
+size_t MemoryUtils::templateBytes(const vector<vector<double>> &vectors) {
+  size_t bytes = 0;
+  for (const auto &v : vectors) {
+    bytes += v.size() * sizeof(double);
+  }
+  return bytes;
+}
+
+
+size_t MemoryUtils::keyMaterialBytes() {
+  size_t bytes = 0;
+
+  for (const auto &tagKeys : CryptoContextImpl<DCRTPoly>::GetAllEvalMultKeys()) {
+    for (const auto &key : tagKeys.second) {
+      for (const auto &poly : key->GetAVector()) {
+        bytes += polyBytes(poly);
+      }
+      for (const auto &poly : key->GetBVector()) {
+        bytes += polyBytes(poly);
+      }
+    }
+  }
+
+  // rotation and summation keys are both stored as automorphism keys
+  for (const auto &tagKeys : CryptoContextImpl<DCRTPoly>::GetAllEvalAutomorphismKeys()) {
+    for (const auto &indexKey : *tagKeys.second) {
+      for (const auto &poly : indexKey.second->GetAVector()) {
+        bytes += polyBytes(poly);
+      }
+      for (const auto &poly : indexKey.second->GetBVector()) {
+        bytes += polyBytes(poly);
+      }
+    }
+  }
+
+  return bytes;
+}
+
+
+void MemoryUtils::addLiveBytes(MemoryKind kind, size_t bytes) {
+  if (kind == CIPHERTEXT_MEMORY) {
+    updatePeak(peakCipherBytes, liveCipherBytes += bytes);
+  } else {
+    updatePeak(peakPlaintextBytes, livePlaintextBytes += bytes);
+  }
+}
+
+
+void MemoryUtils::releaseLiveBytes(MemoryKind kind, size_t bytes) {
+  if (kind == CIPHERTEXT_MEMORY) {
+    liveCipherBytes -= bytes;
+  } else {
+    livePlaintextBytes -= bytes;
+  }
+}
+
+
+size_t MemoryUtils::residentBytes() {
+  return readStatusField("VmRSS");
+}
+
+
+size_t MemoryUtils::peakResidentBytes() {
+  return readStatusField("VmHWM");
+}
+
+
+MemoryUtils::PhaseSample MemoryUtils::samplePhase(const string &phase) {
+  PhaseSample sample = {
+    phase,
+    liveCipherBytes.load(),
+    peakCipherBytes.load(),
+    livePlaintextBytes.load(),
+    peakPlaintextBytes.load(),
+    keyMaterialBytes(),
+    residentBytes(),
+    peakResidentBytes()
+  };
+
+  lock_guard<mutex> lock(sampleMutex);
+  phaseSamples.push_back(sample);
+  return sample;
+}
+
+
+vector<MemoryUtils::PhaseSample> MemoryUtils::takeSamples() {
+  lock_guard<mutex> lock(sampleMutex);
+  vector<PhaseSample> samples;
+  samples.swap(phaseSamples);
+  return samples;
+}
+
+
+void MemoryUtils::writeSamples(const string &filepath, const string &label, const vector<PhaseSample> &samples) {
+  ofstream memStream(filepath, ios::app);
+  if (!memStream.is_open()) {
+    cerr << "Error: cannot write memory report to \"" << filepath << "\"" << endl;
+    return;
+  }
+
+  for (const auto &sample : samples) {
+    memStream << label << "," << sample.phase << ",";
+    memStream << sample.liveCipherBytes << "," << sample.peakCipherBytes << ",";
+    memStream << sample.livePlaintextBytes << "," << sample.peakPlaintextBytes << ",";
+    memStream << sample.keyBytes << ",";
+    memStream << sample.residentBytes << "," << sample.peakResidentBytes << endl;
+  }
+  memStream.close();
+}
+
+// -------------------- SCOPED LIVE BYTES --------------------
+
+MemoryUtils::ScopedLiveBytes::ScopedLiveBytes(MemoryKind kindParam, size_t bytesParam)
+    : kind(kindParam), bytes(bytesParam) {
+  addLiveBytes(kind, bytes);
+}
+
+MemoryUtils::ScopedLiveBytes::~ScopedLiveBytes() {
+  releaseLiveBytes(kind, bytes);
+}
+
+void MemoryUtils::ScopedLiveBytes::add(size_t extraBytes) {
+  bytes += extraBytes;
+  addLiveBytes(kind, extraBytes);
+}
@@ -1,4 +1,34 @@
 #include "../include/openFHE_wrapper.h"
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+#include "utils/prng/blake2engine.h"
+#include <cstring>
+#include <random>
+
+// leading bytes of a seeded ciphertext file, anything else is read as a regular serialized ciphertext
+static const char SEEDED_MAGIC[8] = {'S', 'E', 'E', 'D', 'E', 'D', 'C', '1'};
+
+// Relationship between required depth and Chebyshev polynomial degree described at the below link
+// https://github.com/openfheorg/openfhe-development/blob/main/src/pke/examples/FUNCTION_EVALUATION.md
+static const vector<int> DEPTH_TO_DEGREE({
+  -1, -1, -1, 5, 13, 27, 59, 119, 247, 495, 1007, 2031
+});
+
+// Coefficients for sign-approximating polynomial f4() given from JH Cheon, 2019/1234 (https://ia.cr/2019/1234)
+static const vector<double> F4_COEFS({
+  0.0, 
+  315.0 / 128.0,  
+  0.0, 
+  -420.0 / 128.0, 
+  0.0, 
+  378.0 / 128.0,
+  0.0, 
+  -180.0 / 128.0,
+  0.0,
+  35.0 / 128.0
+});
 
 // Function to compute required multiplicative depth of system
 // Based on algorithmic approach, precision parameters for comparison and group testing functions
@@ -38,11 +68,270 @@ size_t OpenFHEWrapper::computeRequiredDepth(size_t approach) {
       depth += 1;           // one mult required for score computation
       depth += COMP_DEPTH;  // mults required for threshold comparison
       break;
+
+    case 6: // HERS with server-side query expansion
+      depth += 1;           // one mult required for query expansion mask
+      depth += 1;           // one mult required for score computation
+      depth += COMP_DEPTH;  // mults required for threshold comparison
+      break;
+  }
+
+  // one mult required for tombstone mask of the HERS-layout approaches
+  if (TOMBSTONE_MASKING && approach >= 4) {
+    depth += 1;
+  }
+
+  return depth;
+}
+
+// depth needed by the similarity scores alone, as returned by the score scenario
+// the receiver thresholds scores in plaintext, so no depth is planned for the comparison
+size_t OpenFHEWrapper::computeScoreDepth(size_t approach) {
+
+  size_t depth = 1; // one mult required for score computation
+
+  switch(approach) {
+
+    case 1: // literature baseline
+    case 2: // GROTE
+      depth += 2;   // two mults required for merge operation
+      break;
+
+    case 3: // blind-match
+      depth += 1;   // one mult required for compression operation
+      break;
+
+    case 6: // HERS with server-side query expansion
+      depth += 1;   // one mult required for query expansion mask
+      break;
+  }
+
+  // one mult required for tombstone mask of the HERS-layout approaches
+  if (TOMBSTONE_MASKING && approach >= 4) {
+    depth += 1;
+  }
+
+  return depth;
+}
+
+// additional depth consumed by per-identity aggregation, i.e. the masks of mergeCiphers over IDENTITY_BLOCK_LEN
+// counted for the largest batch size of 2^16 slots so that it holds for whichever ring is chosen
+size_t OpenFHEWrapper::computeIdentityDepth() {
+
+  size_t maxBatchSize = size_t(1) << 16;
+  size_t depth = 1;         // one mult required for the final merge mask
+  size_t paddingSize = 1;
+  for(size_t i = 1; i < maxBatchSize / IDENTITY_BLOCK_LEN; i *= 2) {
+    if(i >= paddingSize) {
+      depth += 1;           // one mult required each time rotations exhaust the padding
+      paddingSize = i * IDENTITY_BLOCK_LEN;
+    }
   }
 
   return depth;
 }
 
+// additional depth consumed by the argmax scenario on top of the approach's own comparison depth
+size_t OpenFHEWrapper::computeArgmaxDepth() {
+
+  size_t depth = 0;
+  depth += ARGMAX_ROUNDS * (ARGMAX_STEP_DEPTH + 1); // one comparison and one mult per tournament round
+  depth += 1;                                       // one mult required to isolate block maxima
+  depth += 1;                                       // one mult required to encode template indices
+  depth += 1;                                       // one mult required to isolate block results
+  return depth;
+}
+
+// additional depth consumed by the tiered scenario's shared-basis comparison over chebyshevCompare
+size_t OpenFHEWrapper::computeTieredDepth() {
+  return 1; // one mult required to weight the baby steps ahead of the giant-step products
+}
+
+// length of the slot blocks reduced by the argmax tournament, 0 if the rounds cannot cover all result ciphers
+// tournament rounds are spent first on folding ciphers together, the remainder on rotations within blocks
+// blocks hold at least four slots so that their leader has room for the encoded index, maximum and count
+size_t OpenFHEWrapper::argmaxBlockLength(size_t numCiphers) {
+
+  size_t cipherRounds = ceil(log2(double(numCiphers)));
+  if (cipherRounds + 2 > ARGMAX_ROUNDS) {
+    return 0;
+  }
+
+  return size_t(1) << (ARGMAX_ROUNDS - cipherRounds);
+}
+
+// decodes the block leaders of an argmax response, laid out as by HersSender::argmaxScenario
+// the index is read from the flag-weighted sum over the flag count, the count only has to show a flagged slot
+// returns the best-scoring database index if it matches, or nothing if no match or a tie is found
+vector<size_t> OpenFHEWrapper::decodeArgmax(const vector<double> &argmaxValues, size_t batchSize, size_t numVectors) {
+
+  vector<size_t> outputValues;
+  size_t blockLength = argmaxBlockLength(ceil(double(numVectors) / double(batchSize)));
+  if (blockLength == 0) {
+    cerr << "Error: ARGMAX_ROUNDS cannot cover a database of " << numVectors << " vectors" << endl;
+    return outputValues;
+  }
+
+  size_t bestLeader = 0;
+  for(size_t j = blockLength; j < batchSize; j += blockLength) {
+    if(argmaxValues[j + 1] > argmaxValues[bestLeader + 1]) {
+      bestLeader = j;
+    }
+  }
+
+  if(argmaxValues[bestLeader + 1] < MATCH_THRESHOLD) {
+    return outputValues;
+  }
+
+  double count = argmaxValues[bestLeader + 2];
+  if(count < 0.5) {
+    cerr << "Error: no slot is flagged at the best score in argmax results" << endl;
+    return outputValues;
+  }
+  if(lround(count / 2.0) > 1) {
+    cerr << "Error: " << lround(count / 2.0) << " matches tie for the best score in argmax results" << endl;
+    return outputValues;
+  }
+
+  // partly flagged neighbours pull the weighted mean off the encoding of the best match
+  double encoded = argmaxValues[bestLeader] / count - 1.0;
+  if(encoded < -0.25 || fabs(encoded - round(encoded)) > 0.25) {
+    cerr << "Error: argmax results do not single out one match" << endl;
+    return outputValues;
+  }
+
+  size_t position = size_t(lround(encoded));
+  size_t index = (position / blockLength) * batchSize + bestLeader + (position % blockLength);
+  if(index < numVectors) {
+    outputValues.push_back(index);
+  }
+
+  return outputValues;
+}
+
+// ---------- plaintext simulation ----------
+// evaluates the comparison polynomials in the clear, so that decoding can be checked against exact results
+// CKKS noise is left out, being far below the approximation error of the polynomials
+
+// same Chebyshev interpolation at (degree + 1) nodes as EvalChebyshevFunction, followed by F4 and the shift to [0,2]
+vector<double> OpenFHEWrapper::simulateCompare(const vector<double> &values, double delta, size_t signDepth,
+                                               double lower, double upper) {
+
+  if (signDepth < 7 || signDepth > 15) {
+    cerr << "Error: simulateCompare requires a depth parameter between 7 and 15" << endl;
+    return values;
+  }
+
+  const double pi = acos(-1.0);
+  size_t numNodes = DEPTH_TO_DEGREE[signDepth - 4] + 1;
+  vector<double> nodeSigns(numNodes);
+  for(size_t j = 0; j < numNodes; j++) {
+    double node = cos(pi * (j + 0.5) / numNodes) * (upper - lower) / 2.0 + (upper + lower) / 2.0;
+    nodeSigns[j] = (node >= delta) ? 1.0 : -1.0;
+  }
+  vector<double> coefs(numNodes, 0.0);
+  for(size_t i = 0; i < numNodes; i++) {
+    for(size_t j = 0; j < numNodes; j++) {
+      coefs[i] += nodeSigns[j] * cos(pi * i * (j + 0.5) / numNodes);
+    }
+    coefs[i] *= 2.0 / numNodes;
+  }
+
+  vector<double> results(values.size());
+  for(size_t k = 0; k < values.size(); k++) {
+    double t = (2.0 * values[k] - lower - upper) / (upper - lower);
+    double previous = 1.0;
+    double current = t;
+    double sign = coefs[0] / 2.0 + coefs[1] * t;
+    for(size_t i = 2; i < numNodes; i++) {
+      double next = 2.0 * t * current - previous;
+      previous = current;
+      current = next;
+      sign += coefs[i] * current;
+    }
+
+    double smoothed = 0.0;
+    for(size_t i = F4_COEFS.size(); i-- > 0;) {
+      smoothed = smoothed * sign + F4_COEFS[i];
+    }
+    results[k] = smoothed + 1.0;
+  }
+  return results;
+}
+
+// same as approxMax
+vector<double> OpenFHEWrapper::simulateMax(const vector<double> &a, const vector<double> &b, size_t signDepth) {
+
+  vector<double> diff(a.size());
+  for(size_t i = 0; i < a.size(); i++) {
+    diff[i] = a[i] - b[i];
+  }
+  vector<double> step = simulateCompare(diff, 0.0, signDepth, -2.5, 2.5);
+
+  vector<double> maxValues(a.size());
+  for(size_t i = 0; i < a.size(); i++) {
+    maxValues[i] = b[i] + 0.5 * diff[i] * step[i];
+  }
+  return maxValues;
+}
+
+// slot values of the response of HersSender::argmaxScenario for scores in database order
+vector<double> OpenFHEWrapper::simulateArgmax(const vector<double> &scores, size_t batchSize) {
+
+  size_t numCiphers = ceil(double(scores.size()) / double(batchSize));
+  size_t blockLength = argmaxBlockLength(numCiphers);
+  vector<double> argmaxValues(batchSize, 0.0);
+  if (blockLength == 0) {
+    return argmaxValues;
+  }
+
+  // unused slots of the last score cipher hold zero vectors, which score 0
+  vector<vector<double>> scoreSlots(numCiphers, vector<double>(batchSize, 0.0));
+  for(size_t k = 0; k < scores.size(); k++) {
+    scoreSlots[k / batchSize][k % batchSize] = scores[k];
+  }
+
+  // tournament as in HersSender::argmaxTournament
+  vector<vector<double>> roundSlots = scoreSlots;
+  while(roundSlots.size() > 1) {
+    vector<vector<double>> nextSlots((roundSlots.size() + 1) / 2);
+    for(size_t i = 0; i < roundSlots.size() / 2; i++) {
+      nextSlots[i] = simulateMax(roundSlots[2 * i], roundSlots[2 * i + 1], ARGMAX_STEP_DEPTH);
+    }
+    if(roundSlots.size() % 2 == 1) {
+      nextSlots.back() = roundSlots.back();
+    }
+    roundSlots = nextSlots;
+  }
+  vector<double> maxSlots = roundSlots[0];
+  for(size_t k = 1; k < blockLength; k *= 2) {
+    vector<double> rotated(batchSize);
+    for(size_t i = 0; i < batchSize; i++) {
+      rotated[i] = maxSlots[(i + k) % batchSize];
+    }
+    maxSlots = simulateMax(maxSlots, rotated, ARGMAX_STEP_DEPTH);
+  }
+
+  // flags and their encoded indices, summed into the leader of each block
+  for(size_t c = 0; c < numCiphers; c++) {
+    vector<double> diff(batchSize);
+    for(size_t j = 0; j < batchSize; j++) {
+      diff[j] = scoreSlots[c][j] - maxSlots[j - j % blockLength];
+    }
+    vector<double> flags = simulateCompare(diff, -ARGMAX_MARGIN, COMP_DEPTH, -2.5, 0.5);
+    for(size_t j = 0; j < batchSize; j++) {
+      size_t leader = j - j % blockLength;
+      argmaxValues[leader] += flags[j] * double(c * blockLength + (j % blockLength) + 1);
+      argmaxValues[leader + 2] += flags[j];
+    }
+  }
+  for(size_t leader = 0; leader < batchSize; leader += blockLength) {
+    argmaxValues[leader + 1] = maxSlots[leader];
+  }
+
+  return argmaxValues;
+}
+
 // output relevant metadata of a given CKKS scheme
 void OpenFHEWrapper::printSchemeDetails(CCParams<CryptoContextCKKSRNS> parameters, CryptoContext<DCRTPoly> cc) {
   cout << "batch size: " << cc->GetEncodingParams()->GetBatchSize() << endl;
@@ -72,6 +361,7 @@ void OpenFHEWrapper::printCipherDetails(Ciphertext<DCRTPoly> ctxt) {
 
 // decrypts a given ciphertext and returns a vector of its contents
 Ciphertext<DCRTPoly> OpenFHEWrapper::encryptFromVector(CryptoContext<DCRTPoly> cc, PublicKey<DCRTPoly> pk, vector<double> vec) {
+  TraceUtils::ScopedSpan span("Encrypt", "encrypt");
   Plaintext ptxt = cc->MakeCKKSPackedPlaintext(vec);
   return cc->Encrypt(pk, ptxt);
 }
@@ -79,21 +369,49 @@ Ciphertext<DCRTPoly> OpenFHEWrapper::encryptFromVector(CryptoContext<DCRTPoly> c
 
 // decrypts a given ciphertext and returns a vector of its contents
 vector<double> OpenFHEWrapper::decryptToVector(CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk, Ciphertext<DCRTPoly> ctxt) {
+  TraceUtils::ScopedSpan span("Decrypt", "decrypt");
   Plaintext ptxt;
   cc->Decrypt(sk, ctxt, &ptxt);
   return ptxt->GetRealPackedValue();
 }
 
 // decrypts a given vector of ciphertexts and returns a vector of their contents
+// ciphers are decrypted in parallel, each into its own range of the output
 vector<double> OpenFHEWrapper::decryptVectorToVector(CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk, vector<Ciphertext<DCRTPoly>> ctxt) {
   size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
-  vector<double> temp(batchSize);
   vector<double> output(batchSize * ctxt.size());
-  Plaintext ptxt;
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < ctxt.size(); i++) {
+    TraceUtils::ScopedSpan span("Decrypt", "decrypt");
+    Plaintext ptxt;
+    cc->Decrypt(sk, ctxt[i], &ptxt);
+    const vector<double> &values = ptxt->GetRealPackedValue();
+    copy(values.begin(), values.begin() + batchSize, output.begin() + i * batchSize);
+  }
+  return output;
+}
+
+
+// decrypts ciphers in parallel and returns the positions (cipher * batchSize + slot) of slots >= threshold, in order
+// slots are thresholded per cipher as soon as it is decrypted, so the decrypted values are never concatenated
+vector<size_t> OpenFHEWrapper::decryptThresholdIndices(CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk,
+                                                       vector<Ciphertext<DCRTPoly>> &ctxt, double threshold) {
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  vector<vector<size_t>> cipherIndices(ctxt.size());
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < ctxt.size(); i++) {
+    TraceUtils::ScopedSpan span("Decrypt", "decrypt");
+    Plaintext ptxt;
     cc->Decrypt(sk, ctxt[i], &ptxt);
-    temp = ptxt->GetRealPackedValue();
-    copy(temp.begin(), temp.end(), output.begin() + i * batchSize);
+    const vector<double> &values = ptxt->GetRealPackedValue();
+    VectorUtils::thresholdIndices(values.data(), batchSize, threshold, i * batchSize, cipherIndices[i]);
+  }
+
+  vector<size_t> output;
+  for(size_t i = 0; i < ctxt.size(); i++) {
+    output.insert(output.end(), cipherIndices[i].begin(), cipherIndices[i].end());
   }
   return output;
 }
@@ -121,6 +439,7 @@ Ciphertext<DCRTPoly> OpenFHEWrapper::binaryRotate(CryptoContext<DCRTPoly> cc, Ci
   }
 
   for(size_t i = 0; i < neededRotations.size(); i++) {
+    TraceUtils::ScopedSpan span("EvalRotate", "rotation");
     ctxt = cc->EvalRotate(ctxt, neededRotations[i]);
   }
 
@@ -130,6 +449,7 @@ Ciphertext<DCRTPoly> OpenFHEWrapper::binaryRotate(CryptoContext<DCRTPoly> cc, Ci
 // todo: replace built-in EvalSum function with this, remove generation of SumKey
 // Sets every slot in the ciphertext equal to the sum of all slots
 Ciphertext<DCRTPoly> OpenFHEWrapper::sumAllSlots(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt) {
+  TraceUtils::ScopedSpan span("sumAllSlots", "reduction");
   int batchSize = cc->GetEncodingParams()->GetBatchSize();
   Ciphertext<DCRTPoly> temp;
   for(int i = 1; i < batchSize; i *= 2) {
@@ -140,38 +460,22 @@ Ciphertext<DCRTPoly> OpenFHEWrapper::sumAllSlots(CryptoContext<DCRTPoly> cc, Cip
 }
 
 // Approximates the piecewise comparison function x = { 2 if x >= delta ; 0 if x < delta }
+// inputs must lie within [lower, upper]
 Ciphertext<DCRTPoly>
-OpenFHEWrapper::chebyshevCompare(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt, double delta, size_t signDepth) {
+OpenFHEWrapper::chebyshevCompare(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt, double delta, size_t signDepth,
+                                 double lower, double upper) {
 
   if (signDepth < 7 || signDepth > 15) {
     cerr << "Error: chebshevCompare requires a depth parameter between 7 and 15" << endl;
     return ctxt;
   }
 
-  // Relationship between required depth and Chebyshev polynomial degree described at the below link
-  // https://github.com/openfheorg/openfhe-development/blob/main/src/pke/examples/FUNCTION_EVALUATION.md
-  const vector<int> DEPTH_TO_DEGREE({
-    -1, -1, -1, 5, 13, 27, 59, 119, 247, 495, 1007, 2031
-  });
-
-  // Coefficients for sign-approximating polynomial f4() given from JH Cheon, 2019/1234 (https://ia.cr/2019/1234)
-  const vector<double> F4_COEFS({
-    0.0, 
-    315.0 / 128.0,  
-    0.0, 
-    -420.0 / 128.0, 
-    0.0, 
-    378.0 / 128.0,
-    0.0, 
-    -180.0 / 128.0,
-    0.0,
-    35.0 / 128.0
-  });
+  TraceUtils::ScopedSpan span("chebyshevCompare", "comparison");
 
   // compute Chebyshev approximation of sign function first for steeper slope near x=0
   // set to use a multiplicative depth of (signDepth - 3) 
   size_t polyDegree = DEPTH_TO_DEGREE[signDepth - 4];
-  ctxt = cc->EvalChebyshevFunction([&delta](double x) -> double { return (x >= delta) ? 1 : -1; }, ctxt, -1, 1, polyDegree);
+  ctxt = cc->EvalChebyshevFunction([&delta](double x) -> double { return (x >= delta) ? 1 : -1; }, ctxt, lower, upper, polyDegree);
 
   // compute Cheon's polynomial approximation for smoother zeroing near x=-1 and x=1
   // requires multiplicative depth of 3
@@ -185,6 +489,139 @@ OpenFHEWrapper::chebyshevCompare(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly
 }
 
 
+// Approximates chebyshevCompare against each of several thresholds, outputting one cipher per threshold
+// the Chebyshev basis of ctxt is built once as baby steps T_1..T_{m-1} and giant steps T_m..T_{Jm}
+// each threshold then costs J products and f4() instead of a full polynomial evaluation
+// consumes a depth of (signDepth + 1)
+vector<Ciphertext<DCRTPoly>>
+OpenFHEWrapper::chebyshevCompareMulti(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> ctxt, const vector<double> &deltas,
+                                      size_t signDepth) {
+
+  if (signDepth < 7 || signDepth > 15) {
+    cerr << "Error: chebshevCompareMulti requires a depth parameter between 7 and 15" << endl;
+    return vector<Ciphertext<DCRTPoly>>(deltas.size(), ctxt);
+  }
+
+  TraceUtils::ScopedSpan span("chebyshevCompareMulti", "comparison");
+
+  // same polynomial degree as chebyshevCompare, with around sqrt(degree) baby and giant steps
+  size_t polyDegree = DEPTH_TO_DEGREE[signDepth - 4];
+  size_t babySteps = 1;
+  while (babySteps * babySteps < polyDegree + 1) {
+    babySteps *= 2;
+  }
+  size_t giantSteps = (polyDegree + babySteps) / babySteps - 1;
+
+  // baby steps from T_{a+b} = 2 T_a T_b - T_{a-b}
+  vector<Ciphertext<DCRTPoly>> babyCipher(babySteps + 1);
+  babyCipher[1] = ctxt;
+  for(size_t i = 2; i <= babySteps; i++) {
+    babyCipher[i] = chebyshevProduct(cc, babyCipher[(i + 1) / 2], babyCipher[i / 2], (i % 2) ? babyCipher[1] : nullptr);
+  }
+
+  // giant steps T_{jm} from the same recurrence over multiples of m
+  vector<Ciphertext<DCRTPoly>> giantCipher(giantSteps + 1);
+  giantCipher[1] = babyCipher[babySteps];
+  for(size_t j = 2; j <= giantSteps; j++) {
+    giantCipher[j] = chebyshevProduct(cc, giantCipher[(j + 1) / 2], giantCipher[j / 2], (j % 2) ? giantCipher[1] : nullptr);
+  }
+
+  // bring baby steps to a common level so that their weighted sums need a single rescale
+  size_t babyLevel = babyCipher[babySteps - 1]->GetLevel();
+  for(size_t i = 1; i < babySteps; i++) {
+    if (babyCipher[i]->GetLevel() < babyLevel) {
+      babyCipher[i] = cc->LevelReduce(babyCipher[i], nullptr, babyLevel - babyCipher[i]->GetLevel());
+    }
+  }
+
+  auto babySum = [&](const vector<double> &weights) -> Ciphertext<DCRTPoly> {
+    Ciphertext<DCRTPoly> sum = cc->EvalMult(babyCipher[1], weights[1]);
+    for(size_t i = 2; i < babySteps; i++) {
+      cc->EvalAddInPlace(sum, cc->EvalMult(babyCipher[i], weights[i]));
+    }
+    cc->RescaleInPlace(sum);
+    cc->EvalAddInPlace(sum, weights[0]);
+    return sum;
+  };
+
+  vector<Ciphertext<DCRTPoly>> outputCipher(deltas.size());
+  for(size_t t = 0; t < deltas.size(); t++) {
+    double delta = deltas[t];
+    vector<double> coefs = EvalChebyshevCoefficients([&delta](double x) -> double { return (x >= delta) ? 1 : -1; }, -1.0, 1.0, polyDegree);
+    coefs[0] /= 2.0; // OpenFHE series take half of the constant coefficient
+
+    // rewrite the series as sum_j T_{jm} * q_j + r using T_{jm+i} = 2 T_{jm} T_i - T_{jm-i}
+    // coefficients of T_{jm-i} land in lower blocks, which are rewritten afterwards
+    vector<vector<double>> giantCoefs(giantSteps + 1, vector<double>(babySteps, 0.0));
+    for(size_t j = giantSteps; j > 0; j--) {
+      for(size_t i = 0; i < babySteps; i++) {
+        size_t k = j * babySteps + i;
+        if (k > polyDegree) {
+          break;
+        }
+        if (i == 0) {
+          giantCoefs[j][0] += coefs[k];
+        } else {
+          giantCoefs[j][i] += 2.0 * coefs[k];
+          coefs[k - 2 * i] -= coefs[k];
+        }
+      }
+    }
+
+    Ciphertext<DCRTPoly> result = babySum(coefs);
+    for(size_t j = 1; j <= giantSteps; j++) {
+      Ciphertext<DCRTPoly> term = cc->EvalMult(giantCipher[j], babySum(giantCoefs[j]));
+      cc->RescaleInPlace(term);
+      cc->EvalAddInPlace(result, term);
+    }
+
+    // smoothing and shift to [0,2] as in chebyshevCompare
+    result = cc->EvalPoly(result, F4_COEFS);
+    cc->EvalAddInPlace(result, 1.0);
+    outputCipher[t] = result;
+  }
+
+  return outputCipher;
+}
+
+
+// Computes T_{a+b} = 2 T_a T_b - T_{a-b} from Chebyshev basis ciphers, taking T_0 = 1 when tdiff is null
+Ciphertext<DCRTPoly>
+OpenFHEWrapper::chebyshevProduct(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> &ta, Ciphertext<DCRTPoly> &tb, Ciphertext<DCRTPoly> tdiff) {
+  Ciphertext<DCRTPoly> result = cc->EvalMult(ta, tb);
+  cc->RescaleInPlace(result);
+  result = cc->EvalAdd(result, result);
+  if (tdiff) {
+    cc->EvalSubInPlace(result, tdiff);
+  } else {
+    cc->EvalSubInPlace(result, 1.0);
+  }
+  return result;
+}
+
+
+// Approximates max(a, b) = b + (a - b) * step(a - b) for inputs within [-1, 1]
+// errors of the approximate step only arise where a and b are close, so they barely move the maximum
+// consumes a depth of (signDepth + 1)
+Ciphertext<DCRTPoly>
+OpenFHEWrapper::approxMax(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> a, Ciphertext<DCRTPoly> b, size_t signDepth) {
+
+  Ciphertext<DCRTPoly> diff = cc->EvalSub(a, b);
+
+  // interval leaves headroom for maxima overshooting [-1, 1] in earlier rounds
+  Ciphertext<DCRTPoly> step = OpenFHEWrapper::chebyshevCompare(cc, diff, 0.0, signDepth, -2.5, 2.5);
+
+  // halve the difference in parallel with the comparison, as the comparison outputs 2 rather than 1
+  Ciphertext<DCRTPoly> halfDiff = cc->EvalMult(diff, 0.5);
+  cc->RescaleInPlace(halfDiff);
+
+  TraceUtils::ScopedSpan span("approxMax", "comparison");
+  Ciphertext<DCRTPoly> maxCipher = cc->EvalMult(halfDiff, step);
+  cc->RescaleInPlace(maxCipher);
+  return cc->EvalAdd(maxCipher, b);
+}
+
+
 // packs every i-th slot of each cipher into a consecutive sequence at the front of the outputted cipher(s)
 // can handle cases where the number of slots is larger than the batch size of a single ciphertext
 // requires dimension param to be a power of two
@@ -196,13 +633,14 @@ vector<Ciphertext<DCRTPoly>> OpenFHEWrapper::mergeCiphers(CryptoContext<DCRTPoly
   size_t outputCipher;
   size_t outputSlot;
   
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < ctxts.size(); i++) {
     ctxts[i] = OpenFHEWrapper::mergeSingleCipher(cc, ctxts[i], dimension);
   }
 
   vector<Ciphertext<DCRTPoly>> mergedCipher(neededCiphers);
 
+  TraceUtils::ScopedSpan span("mergeCiphers packing", "reduction");
   for(size_t i = 0; i < ctxts.size(); i++) {
     outputCipher = (elementsPerCipher * i) / batchSize;
     outputSlot = (elementsPerCipher * i) % batchSize;
@@ -221,6 +659,7 @@ vector<Ciphertext<DCRTPoly>> OpenFHEWrapper::mergeCiphers(CryptoContext<DCRTPoly
 // packs every i-th slot of the cipher into a consecutive sequence at the front of the outputted cipher
 // requires dimension param to be a power of two
 Ciphertext<DCRTPoly> OpenFHEWrapper::mergeSingleCipher(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> &ctxt, size_t dimension) {
+  TraceUtils::ScopedSpan span("mergeSingleCipher", "reduction");
 
   size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
   size_t outputSize = batchSize / dimension;
@@ -284,8 +723,9 @@ vector<Ciphertext<DCRTPoly>> OpenFHEWrapper::compressCiphers(CryptoContext<DCRTP
 
   // multiply each ciphertext by one-hot compression mask
   // preserves only the values at the i-th slots
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < ctxts.size(); i++) {
+    TraceUtils::ScopedSpan span("EvalMult mask", "multiply");
     ctxts[i] = cc->EvalMult(ctxts[i], maskPtxt);
     cc->RelinearizeInPlace(ctxts[i]);
     cc->RescaleInPlace(ctxts[i]);
@@ -295,6 +735,7 @@ vector<Ciphertext<DCRTPoly>> OpenFHEWrapper::compressCiphers(CryptoContext<DCRTP
   size_t rotFactor;
   vector<Ciphertext<DCRTPoly>> compressedCtxts(ciphersNeeded);
 
+  TraceUtils::ScopedSpan span("compressCiphers packing", "reduction");
   // combine the masked ciphertexts into a smaller vector of compressed ciphertexts
   for(size_t i = 0; i < ctxts.size(); i++) {
     rotFactor = -(i % dimension);
@@ -309,4 +750,232 @@ vector<Ciphertext<DCRTPoly>> OpenFHEWrapper::compressCiphers(CryptoContext<DCRTP
   }
 
   return compressedCtxts;
+}
+
+
+// drops RNS towers from a result ciphertext until only the fewest needed to decrypt it correctly remain
+// maxValue bounds the absolute value of every slot, RESPONSE_MARGIN_BITS absorb noise and approximation overshoot
+void OpenFHEWrapper::finalizeResponse(CryptoContext<DCRTPoly> cc, Ciphertext<DCRTPoly> &ctxt, double maxValue) {
+  TraceUtils::ScopedSpan span("finalizeResponse", "finalize");
+
+  const auto &towerParams = cc->GetElementParams()->GetParams();
+  size_t currentTowers = ctxt->GetElements()[0].GetNumOfElements();
+  double neededBits = log2(ctxt->GetScalingFactor()) + log2(max(maxValue, 1.0)) + 1.0 + RESPONSE_MARGIN_BITS;
+
+  // towers are always dropped from the end, so the first ones must cover the scaled values
+  size_t neededTowers = 0;
+  double towerBits = 0.0;
+  while(neededTowers < currentTowers && towerBits < neededBits) {
+    towerBits += towerParams[neededTowers]->GetModulus().GetMSB() - 1;
+    neededTowers++;
+  }
+
+  if(neededTowers < currentTowers) {
+    cc->LevelReduceInPlace(ctxt, nullptr, currentTowers - neededTowers);
+  }
+}
+
+// size of a ciphertext as it would be sent over the wire
+size_t OpenFHEWrapper::serializedBytes(Ciphertext<DCRTPoly> ctxt) {
+  stringstream serialStream;
+  Serial::Serialize(ctxt, serialStream, SerType::BINARY);
+  return serialStream.str().size();
+}
+
+size_t OpenFHEWrapper::serializedBytes(vector<Ciphertext<DCRTPoly>> &ctxts) {
+  size_t bytes = 0;
+  for(size_t i = 0; i < ctxts.size(); i++) {
+    bytes += serializedBytes(ctxts[i]);
+  }
+  return bytes;
+}
+
+
+
+// ---------- seeded ciphertexts ----------
+// a fresh secret-key ciphertext is (m + e - a*s, a) with a uniform, so a can be regenerated from a short seed
+// only the first polynomial and the seed are stored or sent, roughly halving the ciphertext size
+
+// expands a seed into a uniform polynomial over the given towers, sampled directly in evaluation format
+DCRTPoly OpenFHEWrapper::seededUniform(shared_ptr<DCRTPoly::Params> params, const CipherSeed &seed) {
+
+  default_prng::Blake2Engine engine(seed);
+  DCRTPoly uniform(params, Format::EVALUATION, true);
+
+  for(size_t i = 0; i < params->GetParams().size(); i++) {
+    auto towerParams = params->GetParams()[i];
+    uint64_t modulus = towerParams->GetModulus().ConvertToInt();
+    size_t ringDim = towerParams->GetRingDimension();
+
+    // rejection sampling keeps values uniform modulo each tower
+    uint64_t bound = numeric_limits<uint64_t>::max() - (numeric_limits<uint64_t>::max() % modulus);
+    NativeVector values(ringDim, towerParams->GetModulus());
+    for(size_t j = 0; j < ringDim; j++) {
+      uint64_t sample;
+      do {
+        sample = (uint64_t(engine()) << 32) | uint64_t(engine());
+      } while(sample >= bound);
+      values[j] = sample % modulus;
+    }
+
+    DCRTPoly::PolyType tower(towerParams, Format::EVALUATION, true);
+    tower.SetValues(values, Format::EVALUATION);
+    uniform.SetElementAtIndex(i, std::move(tower));
+  }
+
+  return uniform;
+}
+
+// secret-key encryption whose second polynomial is generated from a fresh seed, returned through seed
+// saves the public-key multiplication and extra error sampling of cc->Encrypt(pk, ...)
+Ciphertext<DCRTPoly> OpenFHEWrapper::encryptSeeded(CryptoContext<DCRTPoly> cc, PrivateKey<DCRTPoly> sk, vector<double> vec, CipherSeed &seed) {
+  TraceUtils::ScopedSpan span("encryptSeeded", "encrypt");
+
+  // every ciphertext needs its own seed, reusing one under the same key leaks plaintext differences
+  random_device device;
+  for(size_t i = 0; i < seed.size(); i++) {
+    seed[i] = device();
+  }
+
+  Plaintext ptxt = cc->MakeCKKSPackedPlaintext(vec);
+  DCRTPoly message = ptxt->GetElement<DCRTPoly>();
+  message.SetFormat(Format::EVALUATION);
+
+  const auto cryptoParams = dynamic_pointer_cast<CryptoParametersRLWE<DCRTPoly>>(cc->GetCryptoParameters());
+  DCRTPoly uniform = seededUniform(message.GetParams(), seed);
+  DCRTPoly error(cryptoParams->GetDiscreteGaussianGenerator(), message.GetParams(), Format::EVALUATION);
+
+  Ciphertext<DCRTPoly> ctxt = make_shared<CiphertextImpl<DCRTPoly>>(cc, sk->GetKeyTag(), CKKS_PACKED_ENCODING);
+  ctxt->SetElements({message + error - uniform * sk->GetPrivateElement(), uniform});
+  ctxt->SetScalingFactor(ptxt->GetScalingFactor());
+  ctxt->SetNoiseScaleDeg(ptxt->GetNoiseScaleDeg());
+  ctxt->SetLevel(ptxt->GetLevel());
+  ctxt->SetSlots(ptxt->GetSlots());
+
+  return ctxt;
+}
+
+// compact format: magic, seed, ciphertext metadata, key tag, then the serialized first polynomial
+void OpenFHEWrapper::writeSeeded(ostream &stream, Ciphertext<DCRTPoly> ctxt, const CipherSeed &seed) {
+
+  double scalingFactor = ctxt->GetScalingFactor();
+  uint32_t level = ctxt->GetLevel();
+  uint32_t noiseScaleDeg = ctxt->GetNoiseScaleDeg();
+  uint32_t slots = ctxt->GetSlots();
+  string keyTag = ctxt->GetKeyTag();
+  uint32_t tagLength = keyTag.size();
+
+  stream.write(SEEDED_MAGIC, sizeof(SEEDED_MAGIC));
+  stream.write(reinterpret_cast<const char*>(seed.data()), sizeof(seed));
+  stream.write(reinterpret_cast<const char*>(&scalingFactor), sizeof(scalingFactor));
+  stream.write(reinterpret_cast<const char*>(&level), sizeof(level));
+  stream.write(reinterpret_cast<const char*>(&noiseScaleDeg), sizeof(noiseScaleDeg));
+  stream.write(reinterpret_cast<const char*>(&slots), sizeof(slots));
+  stream.write(reinterpret_cast<const char*>(&tagLength), sizeof(tagLength));
+  stream.write(keyTag.data(), tagLength);
+  Serial::Serialize(ctxt->GetElements()[0], stream, SerType::BINARY);
+}
+
+bool OpenFHEWrapper::serializeSeededToFile(const string &filepath, Ciphertext<DCRTPoly> ctxt, const CipherSeed &seed) {
+
+  ofstream file(filepath, ios::out | ios::binary);
+  if(!file.is_open()) {
+    return false;
+  }
+
+  writeSeeded(file, ctxt, seed);
+  return file.good();
+}
+
+// reads either a seeded or a regular serialized ciphertext
+bool OpenFHEWrapper::deserializeCipherFromFile(CryptoContext<DCRTPoly> cc, const string &filepath, Ciphertext<DCRTPoly> &ctxt) {
+
+  ifstream file(filepath, ios::in | ios::binary);
+  if(!file.is_open()) {
+    return false;
+  }
+
+  char magic[sizeof(SEEDED_MAGIC)];
+  file.read(magic, sizeof(magic));
+  if(!file || memcmp(magic, SEEDED_MAGIC, sizeof(magic)) != 0) {
+    file.close();
+    ctxt = nullptr;
+    return Serial::DeserializeFromFile(filepath, ctxt, SerType::BINARY) && ctxt != nullptr;
+  }
+
+  CipherSeed seed;
+  double scalingFactor;
+  uint32_t level, noiseScaleDeg, slots, tagLength;
+  file.read(reinterpret_cast<char*>(seed.data()), sizeof(seed));
+  file.read(reinterpret_cast<char*>(&scalingFactor), sizeof(scalingFactor));
+  file.read(reinterpret_cast<char*>(&level), sizeof(level));
+  file.read(reinterpret_cast<char*>(&noiseScaleDeg), sizeof(noiseScaleDeg));
+  file.read(reinterpret_cast<char*>(&slots), sizeof(slots));
+  file.read(reinterpret_cast<char*>(&tagLength), sizeof(tagLength));
+  string keyTag(tagLength, '\0');
+  file.read(&keyTag[0], tagLength);
+  if(!file) {
+    return false;
+  }
+
+  DCRTPoly first;
+  Serial::Deserialize(first, file, SerType::BINARY);
+  if(!file) {
+    return false;
+  }
+
+  ctxt = make_shared<CiphertextImpl<DCRTPoly>>(cc, keyTag, CKKS_PACKED_ENCODING);
+  ctxt->SetElements({first, seededUniform(first.GetParams(), seed)});
+  ctxt->SetScalingFactor(scalingFactor);
+  ctxt->SetNoiseScaleDeg(noiseScaleDeg);
+  ctxt->SetLevel(level);
+  ctxt->SetSlots(slots);
+
+  return true;
+}
+
+// writes the context, public key and evaluation keys into dirpath, as read back by deserializeContext
+// the secret key is left out so that the directory can be handed to senders
+bool OpenFHEWrapper::serializeContext(CryptoContext<DCRTPoly> cc, PublicKey<DCRTPoly> pk, const string &dirpath) {
+
+  if (!Serial::SerializeToFile(dirpath + "cryptocontext.bin", cc, SerType::BINARY)
+      || !Serial::SerializeToFile(dirpath + "publickey.bin", pk, SerType::BINARY)) {
+    cerr << "Error: cannot serialize context and keys to \"" << dirpath << "\"" << endl;
+    return false;
+  }
+
+  ofstream multKeyFile(dirpath + "multkey.bin", ios::out | ios::binary);
+  ofstream sumKeyFile(dirpath + "sumkey.bin", ios::out | ios::binary);
+  ofstream rotKeyFile(dirpath + "rotkey.bin", ios::out | ios::binary);
+  if (!multKeyFile.is_open() || !cc->SerializeEvalMultKey(multKeyFile, SerType::BINARY)
+      || !sumKeyFile.is_open() || !cc->SerializeEvalSumKey(sumKeyFile, SerType::BINARY)
+      || !rotKeyFile.is_open() || !cc->SerializeEvalAutomorphismKey(rotKeyFile, SerType::BINARY)) {
+    cerr << "Error: cannot serialize evaluation keys to \"" << dirpath << "\"" << endl;
+    return false;
+  }
+
+  return true;
+}
+
+
+// reads the context, public key and evaluation keys written by serializeContext
+bool OpenFHEWrapper::deserializeContext(CryptoContext<DCRTPoly> &cc, PublicKey<DCRTPoly> &pk, const string &dirpath) {
+
+  if (!Serial::DeserializeFromFile(dirpath + "cryptocontext.bin", cc, SerType::BINARY)
+      || !Serial::DeserializeFromFile(dirpath + "publickey.bin", pk, SerType::BINARY)) {
+    cerr << "Error: cannot deserialize context and keys from \"" << dirpath << "\"" << endl;
+    return false;
+  }
+
+  ifstream multKeyFile(dirpath + "multkey.bin", ios::in | ios::binary);
+  ifstream sumKeyFile(dirpath + "sumkey.bin", ios::in | ios::binary);
+  ifstream rotKeyFile(dirpath + "rotkey.bin", ios::in | ios::binary);
+  if (!multKeyFile.is_open() || !cc->DeserializeEvalMultKey(multKeyFile, SerType::BINARY)
+      || !sumKeyFile.is_open() || !cc->DeserializeEvalSumKey(sumKeyFile, SerType::BINARY)
+      || !rotKeyFile.is_open() || !cc->DeserializeEvalAutomorphismKey(rotKeyFile, SerType::BINARY)) {
+    cerr << "Error: cannot deserialize evaluation keys from \"" << dirpath << "\"" << endl;
+    return false;
+  }
+
+  return true;
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "../include/query_pipeline.h"
+
+// implementation of functions declared in query_pipeline.h
+
+// -------------------- CONSTRUCTOR --------------------
+
+QueryPipeline::QueryPipeline(Sender *senderParam, size_t similarityWorkersParam, size_t similarityCoresParam,
+                             size_t comparisonWorkersParam, size_t comparisonCoresParam)
+    : sender(senderParam), similarityQueue(PIPELINE_QUEUE_DEPTH), comparisonQueue(PIPELINE_QUEUE_DEPTH),
+      submitted(0), completed(0), similarityBusy(0.0), comparisonBusy(0.0), latency(0.0) {
+
+  similarityWorkersParam = max(size_t(1), similarityWorkersParam);
+  comparisonWorkersParam = max(size_t(1), comparisonWorkersParam);
+  size_t similarityCores = max(size_t(1), similarityCoresParam / similarityWorkersParam);
+  size_t comparisonCores = max(size_t(1), comparisonCoresParam / comparisonWorkersParam);
+
+  for(size_t i = 0; i < similarityWorkersParam; i++) {
+    similarityWorkers.push_back(thread(&QueryPipeline::similarityLoop, this, similarityCores));
+  }
+  for(size_t i = 0; i < comparisonWorkersParam; i++) {
+    comparisonWorkers.push_back(thread(&QueryPipeline::comparisonLoop, this, comparisonCores));
+  }
+}
+
+QueryPipeline::QueryPipeline(Sender *senderParam)
+    : QueryPipeline(senderParam, PIPELINE_SIMILARITY_WORKERS, PIPELINE_SIMILARITY_CORES,
+                    PIPELINE_COMPARISON_WORKERS, MAX_NUM_CORES - PIPELINE_SIMILARITY_CORES) {}
+
+// the comparison queue is only closed once every similarity worker has handed over its last query
+QueryPipeline::~QueryPipeline() {
+  similarityQueue.close();
+  for(size_t i = 0; i < similarityWorkers.size(); i++) {
+    similarityWorkers[i].join();
+  }
+  comparisonQueue.close();
+  for(size_t i = 0; i < comparisonWorkers.size(); i++) {
+    comparisonWorkers[i].join();
+  }
+}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+future<vector<Ciphertext<DCRTPoly>>> QueryPipeline::submit(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+
+  shared_ptr<Job> job = make_shared<Job>();
+  job->queryCipher = queryCipher;
+  job->submitted = chrono::steady_clock::now();
+  future<vector<Ciphertext<DCRTPoly>>> result = job->result.get_future();
+  {
+    lock_guard<mutex> lock(metricsMutex);
+    submitted++;
+  }
+
+  similarityQueue.push(job);
+  return result;
+}
+
+
+QueryPipeline::Metrics QueryPipeline::metrics() {
+  lock_guard<mutex> lock(metricsMutex);
+  Metrics current;
+  current.submitted = submitted;
+  current.completed = completed;
+  current.similarityBusy = similarityBusy.count();
+  current.comparisonBusy = comparisonBusy.count();
+  current.meanLatency = (completed > 0) ? latency.count() / double(completed) : 0.0;
+  return current;
+}
+
+// -------------------- PRIVATE FUNCTIONS --------------------
+
+// parallel regions started by a stage worker, including those inside OpenFHE, use its share of the stage's cores
+void QueryPipeline::similarityLoop(size_t cores) {
+
+  ThreadBudget::ScopedBudget budget(cores);
+  omp_set_num_threads(cores);
+
+  shared_ptr<Job> job;
+  while (similarityQueue.pop(job)) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    try {
+      job->scoreCipher = sender->computeSimilarity(job->queryCipher);
+    } catch (...) {
+      job->result.set_exception(current_exception());
+      continue;
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    job->queryCipher.clear();
+    {
+      lock_guard<mutex> lock(metricsMutex);
+      similarityBusy += end - start;
+    }
+
+    comparisonQueue.push(job);
+  }
+}
+
+
+void QueryPipeline::comparisonLoop(size_t cores) {
+
+  ThreadBudget::ScopedBudget budget(cores);
+  omp_set_num_threads(cores);
+
+  shared_ptr<Job> job;
+  while (comparisonQueue.pop(job)) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<Ciphertext<DCRTPoly>> indexCipher;
+    try {
+      MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(job->scoreCipher));
+      indexCipher = sender->compareScores(job->scoreCipher);
+    } catch (...) {
+      job->result.set_exception(current_exception());
+      continue;
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    job->scoreCipher.clear();
+    job->result.set_value(indexCipher);
+
+    lock_guard<mutex> lock(metricsMutex);
+    completed++;
+    comparisonBusy += end - start;
+    latency += end - job->submitted;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "../include/query_scheduler.h"
+
+// implementation of functions declared in query_scheduler.h
+
+const QueryScheduler::Deadline QueryScheduler::NO_DEADLINE = QueryScheduler::Deadline::max();
+
+// -------------------- CONSTRUCTOR --------------------
+
+QueryScheduler::QueryScheduler(Sender *senderParam, GalleryManager *galleriesParam, Options optionsParam)
+    : sender(senderParam), galleries(galleriesParam), options(optionsParam), stopping(false), nextSequence(0), exclusiveWaiting(0),
+      admitted(0), rejected(0), completed(0), missedDeadlines(0), batches(0), waitTime(0.0), serviceTime(0.0) {
+
+  options.workers = max(size_t(1), options.workers);
+  options.maxBatch = max(size_t(1), options.maxBatch);
+  workerCores = max(size_t(1), MAX_NUM_CORES / options.workers);
+
+  for(size_t i = 0; i < options.workers; i++) {
+    workers.push_back(thread(&QueryScheduler::workerLoop, this));
+  }
+}
+
+QueryScheduler::QueryScheduler(Sender *senderParam, Options optionsParam)
+    : QueryScheduler(senderParam, nullptr, optionsParam) {}
+
+QueryScheduler::QueryScheduler(Sender *senderParam) : QueryScheduler(senderParam, Options()) {}
+
+// galleries is read by the workers, so it has to be in place before the common constructor starts them
+QueryScheduler::QueryScheduler(GalleryManager *galleriesParam, Options optionsParam)
+    : QueryScheduler(nullptr, galleriesParam, optionsParam) {}
+
+QueryScheduler::~QueryScheduler() {
+  {
+    lock_guard<mutex> lock(queueMutex);
+    stopping = true;
+  }
+  queueCondition.notify_all();
+  for(size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+// a query with a deadline is only admitted if the queries ahead of it and its own evaluation can finish in time,
+// estimated from the mean service time of the batches evaluated so far
+bool QueryScheduler::submit(vector<Ciphertext<DCRTPoly>> &queryCipher, Scenario scenario, Deadline deadline,
+                            future<vector<Ciphertext<DCRTPoly>>> &result) {
+
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  {
+    lock_guard<mutex> lock(queueMutex);
+    bool admit = !stopping && queue.size() < options.maxQueued && deadline > now;
+    if (admit && deadline != NO_DEADLINE && batches > 0) {
+      double meanService = serviceTime.count() / double(batches);
+      double expectedFinish = (double(queue.size() / options.workers) + 1.0) * meanService;
+      admit = now + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(expectedFinish)) <= deadline;
+    }
+    if (!admit) {
+      rejected++;
+      return false;
+    }
+
+    Request request;
+    request.queryCipher = queryCipher;
+    request.scenario = scenario;
+    request.deadline = deadline;
+    request.sequence = nextSequence++;
+    request.admitted = now;
+    result = request.result.get_future();
+    queue.push_back(move(request));
+    admitted++;
+  }
+  queueCondition.notify_one();
+  return true;
+}
+
+
+void QueryScheduler::exclusive(const function<void()> &task) {
+  {
+    lock_guard<mutex> lock(queueMutex);
+    exclusiveWaiting++;
+  }
+  {
+    unique_lock<shared_mutex> contextLock(contextMutex);
+    task();
+  }
+  {
+    lock_guard<mutex> lock(queueMutex);
+    exclusiveWaiting--;
+  }
+  queueCondition.notify_all();
+}
+
+
+size_t QueryScheduler::coresPerQuery() {
+  return workerCores;
+}
+
+
+QueryScheduler::Metrics QueryScheduler::metrics() {
+  lock_guard<mutex> lock(queueMutex);
+  Metrics current;
+  current.admitted = admitted;
+  current.rejected = rejected;
+  current.completed = completed;
+  current.missedDeadlines = missedDeadlines;
+  current.batches = batches;
+  current.meanWait = (completed > 0) ? waitTime.count() / double(completed) : 0.0;
+  current.meanService = (batches > 0) ? serviceTime.count() / double(batches) : 0.0;
+  return current;
+}
+
+// -------------------- PRIVATE FUNCTIONS --------------------
+
+// ties between equal deadlines are broken in arrival order
+vector<QueryScheduler::Request>::iterator QueryScheduler::nextRequest(const Scenario *scenario) {
+  vector<Request>::iterator next = queue.end();
+  for(vector<Request>::iterator it = queue.begin(); it != queue.end(); it++) {
+    if (scenario != nullptr && it->scenario != *scenario) {
+      continue;
+    }
+    if (next == queue.end()) {
+      next = it;
+    } else if (options.policy == EARLIEST_DEADLINE && it->deadline != next->deadline) {
+      next = (it->deadline < next->deadline) ? it : next;
+    } else if (it->sequence < next->sequence) {
+      next = it;
+    }
+  }
+  return next;
+}
+
+// index queries arriving within the batch window of the first one are evaluated together
+void QueryScheduler::workerLoop() {
+
+  // parallel regions started by this worker, including those inside OpenFHE, use its share of the cores
+  ThreadBudget::ScopedBudget budget(workerCores);
+  omp_set_num_threads(workerCores);
+
+  unique_lock<mutex> lock(queueMutex);
+  while (true) {
+    queueCondition.wait(lock, [this] { return exclusiveWaiting == 0 && (stopping || !queue.empty()); });
+    if (queue.empty()) {
+      break;
+    }
+
+    vector<Request> batch;
+    vector<Request>::iterator next = nextRequest(nullptr);
+    batch.push_back(move(*next));
+    queue.erase(next);
+
+    if (batch[0].scenario == INDEX && options.batchWindow.count() > 0) {
+      Scenario index = INDEX;
+      Deadline windowEnd = batch[0].admitted + options.batchWindow;
+      while (batch.size() < options.maxBatch) {
+        next = nextRequest(&index);
+        if (next != queue.end()) {
+          batch.push_back(move(*next));
+          queue.erase(next);
+          continue;
+        }
+        bool arrived = queueCondition.wait_until(lock, windowEnd, [this, &index] {
+          return stopping || nextRequest(&index) != queue.end();
+        });
+        if (!arrived || nextRequest(&index) == queue.end()) {
+          break;
+        }
+      }
+    }
+
+    lock.unlock();
+    evaluate(batch);
+    lock.lock();
+  }
+}
+
+
+void QueryScheduler::evaluate(vector<Request> &batch) {
+
+  shared_lock<shared_mutex> contextLock(contextMutex);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  // keeps the gallery version alive until the batch completes, even if it is swapped out meanwhile
+  shared_ptr<Sender> gallerySender;
+  Sender *batchSender = sender;
+  if (galleries != nullptr) {
+    gallerySender = galleries->acquire();
+    batchSender = gallerySender.get();
+  }
+
+  vector<vector<Ciphertext<DCRTPoly>>> results;
+  try {
+    if (batch.size() == 1 && batch[0].scenario == MEMBERSHIP) {
+      results.push_back(vector<Ciphertext<DCRTPoly>>(1, batchSender->membershipScenario(batch[0].queryCipher)));
+    } else if (batch.size() == 1) {
+      results.push_back(batchSender->indexScenario(batch[0].queryCipher));
+    } else {
+      vector<vector<Ciphertext<DCRTPoly>>> queryBatch(batch.size());
+      for(size_t q = 0; q < batch.size(); q++) {
+        queryBatch[q] = batch[q].queryCipher;
+      }
+      results = batchSender->indexScenarioBatch(queryBatch);
+    }
+  } catch (...) {
+    for(size_t q = 0; q < batch.size(); q++) {
+      batch[q].result.set_exception(current_exception());
+    }
+    return;
+  }
+
+  chrono::steady_clock::time_point end = chrono::steady_clock::now();
+  for(size_t q = 0; q < batch.size(); q++) {
+    batch[q].result.set_value(results[q]);
+  }
+
+  lock_guard<mutex> lock(queueMutex);
+  batches++;
+  serviceTime += end - start;
+  for(size_t q = 0; q < batch.size(); q++) {
+    completed++;
+    waitTime += start - batch[q].admitted;
+    if (end > batch[q].deadline) {
+      missedDeadlines++;
+    }
+  }
+}
\ No newline at end of file
@@ -6,4 +6,51 @@
 
 Receiver::Receiver(CryptoContext<DCRTPoly> ccParam,
                          PublicKey<DCRTPoly> pkParam, PrivateKey<DCRTPoly> skParam, size_t vectorParam)
-    : cc(ccParam), pk(pkParam), sk(skParam), numVectors(vectorParam) {}
\ No newline at end of file
+    : cc(ccParam), pk(pkParam), sk(skParam), numVectors(vectorParam) {}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+vector<size_t> Receiver::decryptIndexFromScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) {
+
+  vector<double> scoreValues = decryptScores(scoreCipher);
+  return VectorUtils::thresholdIndices(scoreValues, MATCH_THRESHOLD);
+}
+
+vector<size_t> Receiver::decryptIdentity(vector<Ciphertext<DCRTPoly>> &identityCipher, const vector<size_t> &blockIdentity) {
+
+  vector<double> blockValues = OpenFHEWrapper::decryptVectorToVector(cc, sk, identityCipher);
+  vector<size_t> outputValues;
+
+  for(size_t i = 0; i < blockIdentity.size(); i++) {
+    if(blockValues[i] >= 1.0) {
+      outputValues.push_back(blockIdentity[i]);
+    }
+  }
+
+  // identities spanning several blocks may be reported more than once
+  sort(outputValues.begin(), outputValues.end());
+  outputValues.erase(unique(outputValues.begin(), outputValues.end()), outputValues.end());
+  return outputValues;
+}
+
+size_t Receiver::queryBytes(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+  return OpenFHEWrapper::serializedBytes(queryCipher);
+}
+
+void Receiver::startEncryptionPool(size_t numQueries) {
+  pool.reset(new EncryptionPool(cc, pk, numQueries * queryCipherCount()));
+}
+
+EncryptionPool *Receiver::encryptionPool() {
+  return pool.get();
+}
+
+// -------------------- PROTECTED FUNCTIONS --------------------
+
+// with a started encryption pool, encryption is reduced to encoding plus an addition
+Ciphertext<DCRTPoly> Receiver::encryptVector(vector<double> &values) {
+  if (pool) {
+    return pool->encrypt(values);
+  }
+  return OpenFHEWrapper::encryptFromVector(cc, pk, values);
+}
\ No newline at end of file
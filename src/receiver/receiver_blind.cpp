@@ -17,42 +17,52 @@ vector<Ciphertext<DCRTPoly>> BlindReceiver::encryptQuery(vector<double> query) {
   query = VectorUtils::plaintextNormalize(query, VECTOR_DIM);
 
   vector<Ciphertext<DCRTPoly>> queryVector(chunksPerVector);
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for (size_t i = 0; i < chunksPerVector; i++) {
     queryVector[i] = encryptQueryThread(query, CHUNK_LEN, (i*CHUNK_LEN));
   }
 
+  // query ciphertexts are held until they are sent
+  MemoryUtils::ScopedLiveBytes queryBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(queryVector));
+  MemoryUtils::samplePhase("query encryption");
   return queryVector;
 }
 
-vector<size_t> BlindReceiver::decryptIndex(vector<Ciphertext<DCRTPoly>> &indexCipher) {
+size_t BlindReceiver::queryCipherCount() {
+  return VECTOR_DIM / CHUNK_LEN;
+}
 
-  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
-  size_t scoresPerBatch = batchSize / CHUNK_LEN;
+vector<size_t> BlindReceiver::decryptIndex(vector<Ciphertext<DCRTPoly>> &indexCipher) {
 
-  vector<size_t> outputValues;
-  vector<double> indexValues;
-  size_t batchStartingIndex, chunkStartingIndex, mergedChunkIndex;
+  MemoryUtils::ScopedLiveBytes indexBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(indexCipher));
+  vector<size_t> outputValues = OpenFHEWrapper::decryptThresholdIndices(cc, sk, indexCipher, 1.0);
+  MemoryUtils::samplePhase("index decryption");
 
   // Determine match indices according to pattern created by compression operation
-  for(size_t i = 0; i < indexCipher.size(); i++) {
-    indexValues = OpenFHEWrapper::decryptToVector(cc, sk, indexCipher[i]);
-
-    for(size_t j = 0; j < batchSize; j++) {
-      // If match is found during iterataion, append to returned list
-      if(indexValues[j] >= 1.0) {
-        batchStartingIndex = i * batchSize;
-        chunkStartingIndex = j / CHUNK_LEN;
-        mergedChunkIndex = (j % CHUNK_LEN) * scoresPerBatch;
-
-        outputValues.push_back(batchStartingIndex + chunkStartingIndex + mergedChunkIndex);
-      }
-    }
+  for(size_t i = 0; i < outputValues.size(); i++) {
+    outputValues[i] = indexOfPosition(outputValues[i]);
   }
   
   return outputValues;
 }
 
+vector<double> BlindReceiver::decryptScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) {
+
+  vector<double> scoreValues = OpenFHEWrapper::decryptVectorToVector(cc, sk, scoreCipher);
+  vector<double> outputValues(numVectors);
+  size_t index;
+
+  // Undo the slot pattern created by compression operation
+  for(size_t i = 0; i < scoreValues.size(); i++) {
+    index = indexOfPosition(i);
+    if(index < numVectors) {
+      outputValues[index] = scoreValues[i];
+    }
+  }
+
+  return outputValues;
+}
+
 // -------------------- PROTECTED FUNCTIONS --------------------
 
 Ciphertext<DCRTPoly> BlindReceiver::encryptQueryThread(vector<double> &query, size_t chunkLength, size_t index) {
@@ -66,6 +76,20 @@ Ciphertext<DCRTPoly> BlindReceiver::encryptQueryThread(vector<double> &query, si
       currentVector.begin() + i);
   }
 
-  return OpenFHEWrapper::encryptFromVector(cc, pk, currentVector);
+  return encryptVector(currentVector);
+
+}
+
+// compression places the score of vector (chunk + k * scoresPerBatch) of a batch at slot (chunk * CHUNK_LEN + k)
+size_t BlindReceiver::indexOfPosition(size_t position) {
 
-}
\ No newline at end of file
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  size_t scoresPerBatch = batchSize / CHUNK_LEN;
+  size_t slot = position % batchSize;
+
+  size_t batchStartingIndex = position - slot;
+  size_t chunkStartingIndex = slot / CHUNK_LEN;
+  size_t mergedChunkIndex = (slot % CHUNK_LEN) * scoresPerBatch;
+
+  return batchStartingIndex + chunkStartingIndex + mergedChunkIndex;
+}
@@ -0,0 +1,25 @@
+#include "../../include/receiver_compact.h"
+
+// implementation of functions declared in receiver_compact.h
+
+// -------------------- CONSTRUCTOR --------------------
+
+CompactReceiver::CompactReceiver(CryptoContext<DCRTPoly> ccParam,
+                         PublicKey<DCRTPoly> pkParam, PrivateKey<DCRTPoly> skParam, size_t vectorParam)
+    : HersReceiver(ccParam, pkParam, skParam, vectorParam) {}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+vector<Ciphertext<DCRTPoly>> CompactReceiver::encryptQuery(vector<double> query) {
+
+  vector<Ciphertext<DCRTPoly>> queryCipher({encryptQueryAlt(query)});
+
+  // query ciphertexts are held until they are sent
+  MemoryUtils::ScopedLiveBytes queryBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(queryCipher));
+  MemoryUtils::samplePhase("query encryption");
+  return queryCipher;
+}
+
+size_t CompactReceiver::queryCipherCount() {
+  return 1;
+}
\ No newline at end of file
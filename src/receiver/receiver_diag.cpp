@@ -20,7 +20,14 @@ vector<Ciphertext<DCRTPoly>> DiagonalReceiver::encryptQuery(vector<double> query
     copy(query.begin(), query.end(), queryBatch.begin() + i);
   }
 
-  vector<Ciphertext<DCRTPoly>> queryCipher({OpenFHEWrapper::encryptFromVector(cc, pk, queryBatch)});
+  vector<Ciphertext<DCRTPoly>> queryCipher({encryptVector(queryBatch)});
 
+  // query ciphertexts are held until they are sent
+  MemoryUtils::ScopedLiveBytes queryBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(queryCipher));
+  MemoryUtils::samplePhase("query encryption");
   return queryCipher;
 }
+
+size_t DiagonalReceiver::queryCipherCount() {
+  return 1;
+}
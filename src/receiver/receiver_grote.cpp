@@ -27,37 +27,24 @@ vector<size_t> GroteReceiver::decryptIndex(vector<Ciphertext<DCRTPoly>> &indexCi
 
 
   // decrypt results
-  vector<double> rowVals = OpenFHEWrapper::decryptVectorToVector(cc, sk, rowCipher);
-  vector<double> colVals = OpenFHEWrapper::decryptVectorToVector(cc, sk, colCipher);
-
-  vector<size_t> rowMatches;
-  vector<size_t> colMatches;
+  MemoryUtils::ScopedLiveBytes indexBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(indexCipher));
+  vector<size_t> rowMatches = OpenFHEWrapper::decryptThresholdIndices(cc, sk, rowCipher, 1.0);
+  vector<size_t> colMatches = OpenFHEWrapper::decryptThresholdIndices(cc, sk, colCipher, 1.0);
+  MemoryUtils::samplePhase("index decryption");
   vector<size_t> matchIndices;
 
-  for(size_t i = 0; i < rowVals.size(); i++) {
-    if(rowVals[i] >= 1.0) {
-      rowMatches.push_back(i);
-    }
-  }
-
-  for(size_t i = 0; i < colVals.size(); i++) {
-    if(colVals[i] >= 1.0) {
-      colMatches.push_back(i);
-    }
-  }
-
+  // both match lists are sorted, so their matrix numbers are non-decreasing
+  // each row is paired only with the run of columns from the same matrix, in O(rows + cols + matches)
   size_t rowMatrixNum;
-  size_t colMatrixNum;
+  size_t colStart = 0;
   for(size_t i = 0; i < rowMatches.size(); i++) {
     rowMatrixNum = rowMatches[i] / colLength;
 
-    for(size_t j = 0; j < colMatches.size(); j++) {
-      colMatrixNum = colMatches[j] / rowLength;
-      
-      if(rowMatrixNum == colMatrixNum) {
-        matchIndices.push_back((rowMatches[i] * rowLength) + (colMatches[j] % rowLength));
-      }
-
+    while(colStart < colMatches.size() && colMatches[colStart] / rowLength < rowMatrixNum) {
+      colStart++;
+    }
+    for(size_t j = colStart; j < colMatches.size() && colMatches[j] / rowLength == rowMatrixNum; j++) {
+      matchIndices.push_back((rowMatches[i] * rowLength) + (colMatches[j] % rowLength));
     }
   }
 
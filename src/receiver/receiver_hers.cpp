@@ -15,17 +15,27 @@ vector<Ciphertext<DCRTPoly>> HersReceiver::encryptQuery(vector<double> query) {
   vector<Ciphertext<DCRTPoly>> queryCipher(VECTOR_DIM);
   query = VectorUtils::plaintextNormalize(query, VECTOR_DIM);
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < VECTOR_DIM; i++) {
     queryCipher[i] = encryptQueryThread(query[i]);
   }
 
+  // query ciphertexts are held until they are sent
+  MemoryUtils::ScopedLiveBytes queryBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(queryCipher));
+  MemoryUtils::samplePhase("query encryption");
   return queryCipher;
 }
 
+size_t HersReceiver::queryCipherCount() {
+  return VECTOR_DIM;
+}
+
 bool HersReceiver::decryptMembership(Ciphertext<DCRTPoly> &membershipCipher) {
 
+  MemoryUtils::ScopedLiveBytes membershipBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(membershipCipher));
   vector<double> membershipValues = OpenFHEWrapper::decryptToVector(cc, sk, membershipCipher);
+  MemoryUtils::ScopedLiveBytes valueBytes(MemoryUtils::PLAINTEXT_MEMORY, membershipValues.size() * sizeof(double));
+  MemoryUtils::samplePhase("membership decryption");
 
   if(membershipValues[0] >= 1.0) {
     return true;
@@ -35,31 +45,91 @@ bool HersReceiver::decryptMembership(Ciphertext<DCRTPoly> &membershipCipher) {
 }
 
 vector<size_t> HersReceiver::decryptIndex(vector<Ciphertext<DCRTPoly>> &indexCipher) {
+  MemoryUtils::ScopedLiveBytes indexBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(indexCipher));
+  vector<size_t> outputValues = OpenFHEWrapper::decryptThresholdIndices(cc, sk, indexCipher, 1.0);
+  MemoryUtils::samplePhase("index decryption");
+  return outputValues;
+}
+
+// decodes streamed index results one cipher at a time, in whichever order they arrive
+vector<size_t> HersReceiver::decryptIndexCipher(Ciphertext<DCRTPoly> &indexCipher, size_t cipherIndex) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  vector<double> indexValues = OpenFHEWrapper::decryptToVector(cc, sk, indexCipher);
+  vector<size_t> outputValues;
+
+  VectorUtils::thresholdIndices(indexValues.data(), batchSize, 1.0, cipherIndex * batchSize, outputValues);
+  for(size_t i = 0; i < outputValues.size(); i++) {
+    outputValues[i] = indexOfPosition(outputValues[i]);
+  }
+
+  return outputValues;
+}
+
+// scores produced by computeSimilarity are already laid out in database order
+vector<double> HersReceiver::decryptScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) {
+
+  vector<double> scoreValues = OpenFHEWrapper::decryptVectorToVector(cc, sk, scoreCipher);
+  scoreValues.resize(numVectors);
+
+  return scoreValues;
+}
+
+// decodes the count and weighted ciphers produced by Sender::sparsifyIndex
+// a match at slot s of index cipher c adds ~2 to the count and ~2(c+1) to the weighted sum at slot s
+vector<size_t> HersReceiver::decryptIndexSparse(vector<Ciphertext<DCRTPoly>> &sparseCipher) {
 
   size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  vector<double> countValues = OpenFHEWrapper::decryptToVector(cc, sk, sparseCipher[0]);
+  vector<double> weightValues = OpenFHEWrapper::decryptToVector(cc, sk, sparseCipher[1]);
   vector<size_t> outputValues;
-  vector<double> indexValues;
+  long matches, cipherIndex;
+
+  for(size_t j = 0; j < batchSize; j++) {
+    if(countValues[j] < 1.0) {
+      continue;
+    }
 
-  for(size_t i = 0; i < indexCipher.size(); i++) {
-    indexValues = OpenFHEWrapper::decryptToVector(cc, sk, indexCipher[i]);
+    matches = lround(countValues[j] / 2.0);
+    if(matches > 1) {
+      cerr << "Error: " << matches << " matches share slot " << j << " and cannot be told apart in sparse results" << endl;
+      continue;
+    }
 
-    for(size_t j = 0; j < batchSize; j++) {
-      if(indexValues[j] >= 1.0) {
-        outputValues.push_back(j + (i * batchSize));
-      }
+    cipherIndex = lround(weightValues[j] / countValues[j]) - 1;
+    size_t index = indexOfPosition(cipherIndex * batchSize + j);
+    if(cipherIndex >= 0 && index < numVectors) {
+      outputValues.push_back(index);
     }
   }
-  
+
+  sort(outputValues.begin(), outputValues.end());
   return outputValues;
 }
 
+// decodes the block leaders produced by HersSender::argmaxScenario
+// returns the best-scoring database index if it matches, or nothing if no match or a tie is found
+vector<size_t> HersReceiver::decryptArgmax(Ciphertext<DCRTPoly> &argmaxCipher) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  vector<double> argmaxValues = OpenFHEWrapper::decryptToVector(cc, sk, argmaxCipher);
+  return OpenFHEWrapper::decodeArgmax(argmaxValues, batchSize, numVectors);
+}
+
+// -------------------- PROTECTED FUNCTIONS --------------------
+
+// maps a slot position across the concatenated result ciphers to its database index
+size_t HersReceiver::indexOfPosition(size_t position) {
+  return position;
+}
+
 // -------------------- PRIVATE FUNCTIONS --------------------
 
 Ciphertext<DCRTPoly> HersReceiver::encryptQueryThread(double indexValue) {
   size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
   vector<double> indexVector(batchSize, indexValue);
-  Plaintext ptxt = cc->MakeCKKSPackedPlaintext(indexVector);
-  return cc->Encrypt(pk, ptxt);
+  TraceUtils::ScopedSpan span("Encrypt", "encrypt");
+  return encryptVector(indexVector);
 }
 
 // encrypts the query vector into a single cipher, requires sender to generate 512 needed ciphers
@@ -73,5 +143,5 @@ Ciphertext<DCRTPoly> HersReceiver::encryptQueryAlt(vector<double> query) {
     copy(query.begin(), query.end(), batchedQuery.begin() + i);
   }
 
-  return OpenFHEWrapper::encryptFromVector(cc, pk, batchedQuery);
+  return encryptVector(batchedQuery);
 }
\ No newline at end of file
@@ -6,4 +6,185 @@
 
 Sender::Sender(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam,
                size_t vectorParam)
-    : cc(ccParam), pk(pkParam), numVectors(vectorParam) {}
\ No newline at end of file
+    : cc(ccParam), pk(pkParam), numVectors(vectorParam), serialRoot(SERIAL_ROOT) {}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+// fallback for approaches whose results are only known once the whole scenario completes
+void Sender::indexScenarioStream(vector<Ciphertext<DCRTPoly>> &queryCipher, const IndexCallback &emit) {
+  vector<Ciphertext<DCRTPoly>> indexCipher = indexScenario(queryCipher);
+  for(size_t i = 0; i < indexCipher.size(); i++) {
+    emit(i, indexCipher[i]);
+  }
+}
+
+vector<Ciphertext<DCRTPoly>> Sender::compareScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) {
+
+  vector<Ciphertext<DCRTPoly>> indexCipher(scoreCipher.size());
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < scoreCipher.size(); i++) {
+    indexCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
+  }
+  MemoryUtils::samplePhase("comparison");
+
+  return indexCipher;
+}
+
+// fallback for approaches without shared gallery loads, evaluates the queries one after another
+vector<vector<Ciphertext<DCRTPoly>>> Sender::indexScenarioBatch(vector<vector<Ciphertext<DCRTPoly>>> &queryBatch) {
+  vector<vector<Ciphertext<DCRTPoly>>> indexBatch(queryBatch.size());
+  for(size_t q = 0; q < queryBatch.size(); q++) {
+    indexBatch[q] = indexScenario(queryBatch[q]);
+  }
+  return indexBatch;
+}
+
+
+vector<Ciphertext<DCRTPoly>> Sender::scoreScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+  return computeSimilarity(queryCipher);
+}
+
+
+// sums the comparison outputs of each block into its first slot, then packs those slots densely
+// requires index results laid out in database order and a power-of-two block length
+vector<Ciphertext<DCRTPoly>> Sender::identityScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t blockLength) {
+
+  vector<Ciphertext<DCRTPoly>> indexCipher = indexScenario(queryCipher);
+
+  {
+    TraceUtils::ScopedSpan span("identity block sum", "reduction");
+    #pragma omp parallel for num_threads(ThreadBudget::cores())
+    for(size_t i = 0; i < indexCipher.size(); i++) {
+      for(size_t k = 1; k < blockLength; k *= 2) {
+        indexCipher[i] = cc->EvalAdd(indexCipher[i], cc->EvalRotate(indexCipher[i], k));
+      }
+    }
+  }
+
+  return OpenFHEWrapper::mergeCiphers(cc, indexCipher, blockLength);
+}
+
+
+// compares every similarity cipher against all thresholds at once, outputting index results as [tier][cipher]
+vector<vector<Ciphertext<DCRTPoly>>> Sender::tieredScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, const vector<double> &thresholds) {
+
+  // compute similarity scores between query and database
+  vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+
+  vector<vector<Ciphertext<DCRTPoly>>> tierCipher(thresholds.size(), vector<Ciphertext<DCRTPoly>>(scoreCipher.size()));
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < scoreCipher.size(); i++) {
+    vector<Ciphertext<DCRTPoly>> compareCipher = OpenFHEWrapper::chebyshevCompareMulti(cc, scoreCipher[i], thresholds, COMP_DEPTH);
+    for(size_t t = 0; t < thresholds.size(); t++) {
+      tierCipher[t][i] = compareCipher[t];
+    }
+  }
+  MemoryUtils::samplePhase("comparison");
+
+  return tierCipher;
+}
+
+
+// sums up each tier into a single result value at the first slot of its cipher
+vector<Ciphertext<DCRTPoly>> Sender::tieredMembership(vector<vector<Ciphertext<DCRTPoly>>> &tierCipher) {
+  TraceUtils::ScopedSpan span("tiered membership sum", "reduction");
+
+  vector<Ciphertext<DCRTPoly>> membershipCipher(tierCipher.size());
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t t = 0; t < tierCipher.size(); t++) {
+    membershipCipher[t] = tierCipher[t][0];
+    for(size_t i = 1; i < tierCipher[t].size(); i++) {
+      membershipCipher[t] = cc->EvalAdd(membershipCipher[t], tierCipher[t][i]);
+    }
+    membershipCipher[t] = cc->EvalSum(membershipCipher[t], cc->GetEncodingParams()->GetBatchSize());
+  }
+
+  return membershipCipher;
+}
+
+
+vector<Ciphertext<DCRTPoly>> Sender::indexScenarioSparse(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+
+  vector<Ciphertext<DCRTPoly>> indexCipher = indexScenario(queryCipher);
+  return sparsifyIndex(indexCipher);
+}
+
+
+void Sender::setSerialRoot(const string &root) {
+  serialRoot = root;
+}
+
+
+// membership result counts up to one comparison output (at most 2) per database vector
+void Sender::finalizeMembership(Ciphertext<DCRTPoly> &membershipCipher) {
+  OpenFHEWrapper::finalizeResponse(cc, membershipCipher, 2.0 * numVectors);
+}
+
+// index results hold one comparison output (at most 2) per slot
+void Sender::finalizeIndex(vector<Ciphertext<DCRTPoly>> &indexCipher) {
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < indexCipher.size(); i++) {
+    finalizeIndex(indexCipher[i]);
+  }
+}
+
+void Sender::finalizeIndex(Ciphertext<DCRTPoly> &indexCipher) {
+  OpenFHEWrapper::finalizeResponse(cc, indexCipher, 2.0);
+}
+
+// score results hold cosine similarities of normalized vectors
+void Sender::finalizeScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) {
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < scoreCipher.size(); i++) {
+    OpenFHEWrapper::finalizeResponse(cc, scoreCipher[i], 1.0);
+  }
+}
+
+// identity results hold the comparison outputs (at most 2) of every template in a block
+void Sender::finalizeIdentity(vector<Ciphertext<DCRTPoly>> &identityCipher) {
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < identityCipher.size(); i++) {
+    OpenFHEWrapper::finalizeResponse(cc, identityCipher[i], 2.0 * IDENTITY_BLOCK_LEN);
+  }
+}
+
+// sparse results hold per-slot sums of comparison outputs, weighted by at most the number of index ciphers
+void Sender::finalizeSparseIndex(vector<Ciphertext<DCRTPoly>> &sparseCipher) {
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  double maxWeight = ceil(double(numVectors) / double(batchSize)) + 1.0;
+
+  OpenFHEWrapper::finalizeResponse(cc, sparseCipher[0], 2.0 * numVectors);
+  OpenFHEWrapper::finalizeResponse(cc, sparseCipher[1], 2.0 * numVectors * maxWeight);
+}
+
+// argmax results hold per-block sums of comparison outputs weighted by encoded indices below (ciphers * block length)
+void Sender::finalizeArgmax(Ciphertext<DCRTPoly> &argmaxCipher) {
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  double numCiphers = ceil(double(numVectors) / double(batchSize));
+  double encodedRange = numCiphers * OpenFHEWrapper::argmaxBlockLength(numCiphers);
+
+  OpenFHEWrapper::finalizeResponse(cc, argmaxCipher, 2.0 * encodedRange * encodedRange);
+}
+
+// -------------------- PROTECTED FUNCTIONS --------------------
+
+// compresses index ciphers into two, holding at each slot the sum of comparison outputs over all ciphers
+// and the same sum weighted by (cipher + 1), from which the receiver recovers the cipher of a single match
+// weighted sum is accumulated from running suffix sums so that no multiplicative depth is consumed
+vector<Ciphertext<DCRTPoly>> Sender::sparsifyIndex(vector<Ciphertext<DCRTPoly>> &indexCipher) {
+  TraceUtils::ScopedSpan span("sparsifyIndex", "reduction");
+
+  Ciphertext<DCRTPoly> countCipher = indexCipher.back();
+  Ciphertext<DCRTPoly> weightCipher = indexCipher.back();
+  for(size_t i = indexCipher.size() - 1; i-- > 0; ) {
+    countCipher = cc->EvalAdd(countCipher, indexCipher[i]);
+    weightCipher = cc->EvalAdd(weightCipher, countCipher);
+  }
+
+  vector<Ciphertext<DCRTPoly>> sparseCipher({countCipher, weightCipher});
+  return sparseCipher;
+}
@@ -18,12 +18,17 @@ vector<Ciphertext<DCRTPoly>> BaseSender::computeSimilarity(vector<Ciphertext<DCR
   vector<Ciphertext<DCRTPoly>> similarityCipher(numBatches);
 
   // embarrassingly parallel
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for (size_t i = 0; i < numBatches; i++) {
     computeSimilarityThread(queryCipher[0], similarityCipher[i], i);
   }
-  
-  return OpenFHEWrapper::mergeCiphers(cc, similarityCipher, VECTOR_DIM);
+
+  // unmerged score ciphertexts stay resident until merging completes
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(similarityCipher));
+  vector<Ciphertext<DCRTPoly>> mergedCipher = OpenFHEWrapper::mergeCiphers(cc, similarityCipher, VECTOR_DIM);
+
+  MemoryUtils::samplePhase("similarity");
+  return mergedCipher;
 }
 
 vector<Ciphertext<DCRTPoly>> BaseSender::computeSimilarityAndMerge(Ciphertext<DCRTPoly> &queryCipher) {
@@ -37,7 +42,7 @@ vector<Ciphertext<DCRTPoly>> BaseSender::computeSimilarityAndMerge(Ciphertext<DC
   vector<Ciphertext<DCRTPoly>> mergedCipher(numMergedCiphers);
 
   // embarrassingly parallel
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for (size_t i = 0; i < numMergedCiphers; i++) {
     // populates mergedCipher with consecutively-packed similarity scores
     computeSimilarityAndMergeThread(queryCipher, mergedCipher[i], i);
@@ -51,14 +56,17 @@ Ciphertext<DCRTPoly> BaseSender::membershipScenario(vector<Ciphertext<DCRTPoly>>
 
   // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
   // vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarityAndMerge(queryCipher);
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < scoreCipher.size(); i++) {
     scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
   }
+  MemoryUtils::samplePhase("comparison");
   
   // sum up all values into single result value at first slot of first cipher
+  TraceUtils::ScopedSpan span("membership sum", "reduction");
   Ciphertext<DCRTPoly> membershipCipher = cc->EvalAddManyInPlace(scoreCipher);
   membershipCipher = cc->EvalSum(membershipCipher, cc->GetEncodingParams()->GetBatchSize());
 
@@ -70,26 +78,36 @@ vector<Ciphertext<DCRTPoly>> BaseSender::indexScenario(vector<Ciphertext<DCRTPol
 
   // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
   // vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarityAndMerge(queryCipher);
-  
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for(size_t i = 0; i < scoreCipher.size(); i++) {
-    scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
-  }
-  
-  return scoreCipher;
+
+  return compareScores(scoreCipher);
+}
+
+
+void BaseSender::indexScenarioStream(vector<Ciphertext<DCRTPoly>> &queryCipher, const IndexCallback &emit) {
+  Sender::indexScenarioStream(queryCipher, emit);
+}
+
+
+vector<vector<Ciphertext<DCRTPoly>>> BaseSender::indexScenarioBatch(vector<vector<Ciphertext<DCRTPoly>>> &queryBatch) {
+  return Sender::indexScenarioBatch(queryBatch);
 }
 
 // -------------------- PROTECTED FUNCTIONS --------------------
 void BaseSender::computeSimilarityThread(Ciphertext<DCRTPoly> &queryCipher, Ciphertext<DCRTPoly> &similarityCipher, size_t databaseIndex) {
 
   Ciphertext<DCRTPoly> databaseCipher;
-  string filepath = "serial/db_baseline/batch" + to_string(databaseIndex) + ".bin";
-  if (!Serial::DeserializeFromFile(filepath, databaseCipher, SerType::BINARY)) {
-      cerr << "Cannot read serialization from " << filepath << endl;
+  string filepath = serialRoot + "db_baseline/batch" + to_string(databaseIndex) + ".bin";
+  {
+    TraceUtils::ScopedSpan span("DeserializeFromFile", "load");
+    if (!OpenFHEWrapper::deserializeCipherFromFile(cc, filepath, databaseCipher)) {
+        cerr << "Cannot read serialization from " << filepath << endl;
+    }
   }
 
   // todo: rewrite this using own sum function
+  TraceUtils::ScopedSpan span("EvalInnerProduct", "multiply");
   similarityCipher = cc->EvalInnerProduct(queryCipher, databaseCipher, VECTOR_DIM);
   cc->RelinearizeInPlace(similarityCipher);
   cc->RescaleInPlace(similarityCipher);
@@ -122,14 +140,20 @@ void BaseSender::computeSimilarityAndMergeThread(Ciphertext<DCRTPoly> &queryCiph
       break;
     }
 
-    filepath = "serial/db_baseline/batch" + to_string(currentIndex) + ".bin";
-    if (!Serial::DeserializeFromFile(filepath, databaseCipher, SerType::BINARY)) {
-        cerr << "Cannot read serialization from " << filepath << endl;
-        break;
+    filepath = serialRoot + "db_baseline/batch" + to_string(currentIndex) + ".bin";
+    {
+      TraceUtils::ScopedSpan span("DeserializeFromFile", "load");
+      if (!OpenFHEWrapper::deserializeCipherFromFile(cc, filepath, databaseCipher)) {
+          cerr << "Cannot read serialization from " << filepath << endl;
+          break;
+      }
+    }
+    {
+      TraceUtils::ScopedSpan span("EvalInnerProduct", "multiply");
+      databaseCipher = cc->EvalInnerProduct(queryCipher, databaseCipher, VECTOR_DIM);
+      cc->RelinearizeInPlace(databaseCipher);
+      cc->RescaleInPlace(databaseCipher);
     }
-    databaseCipher = cc->EvalInnerProduct(queryCipher, databaseCipher, VECTOR_DIM);
-    cc->RelinearizeInPlace(databaseCipher);
-    cc->RescaleInPlace(databaseCipher);
     databaseCipher = OpenFHEWrapper::mergeSingleCipher(cc, databaseCipher, VECTOR_DIM);
 
     cc->EvalAddInPlace(mergedCipher, OpenFHEWrapper::binaryRotate(cc, databaseCipher, -(vectorsPerBatch * j)));
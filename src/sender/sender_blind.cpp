@@ -14,13 +14,16 @@ Ciphertext<DCRTPoly> BlindSender::membershipScenario(vector<Ciphertext<DCRTPoly>
 
   // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < scoreCipher.size(); i++) {
     scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
   }
+  MemoryUtils::samplePhase("comparison");
   
   // sum up all values into single result value at first slot of first cipher
+  TraceUtils::ScopedSpan span("membership sum", "reduction");
   Ciphertext<DCRTPoly> membershipCipher = cc->EvalAddManyInPlace(scoreCipher);
   membershipCipher = cc->EvalSum(membershipCipher, cc->GetEncodingParams()->GetBatchSize());
 
@@ -31,13 +34,17 @@ vector<Ciphertext<DCRTPoly>> BlindSender::indexScenario(vector<Ciphertext<DCRTPo
 
   // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for(size_t i = 0; i < scoreCipher.size(); i++) {
-    scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
-  }
+  return compareScores(scoreCipher);
+}
 
-  return scoreCipher;
+void BlindSender::indexScenarioStream(vector<Ciphertext<DCRTPoly>> &queryCipher, const IndexCallback &emit) {
+  Sender::indexScenarioStream(queryCipher, emit);
+}
+
+vector<vector<Ciphertext<DCRTPoly>>> BlindSender::indexScenarioBatch(vector<vector<Ciphertext<DCRTPoly>>> &queryBatch) {
+  return Sender::indexScenarioBatch(queryBatch);
 }
 
 vector<Ciphertext<DCRTPoly>> BlindSender::computeSimilarity(vector<Ciphertext<DCRTPoly>> &queryCipher) {
@@ -52,7 +59,12 @@ vector<Ciphertext<DCRTPoly>> BlindSender::computeSimilarity(vector<Ciphertext<DC
     scoreCipher[i] = computeSimilarityMatrix(queryCipher, CHUNK_LEN, i);
   }
 
-  return OpenFHEWrapper::compressCiphers(cc, scoreCipher, CHUNK_LEN);
+  // uncompressed score ciphertexts stay resident until compression completes
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+  vector<Ciphertext<DCRTPoly>> compressedCipher = OpenFHEWrapper::compressCiphers(cc, scoreCipher, CHUNK_LEN);
+
+  MemoryUtils::samplePhase("similarity");
+  return compressedCipher;
 }
 
 // -------------------- PROTECTED FUNCTIONS --------------------
@@ -61,11 +73,13 @@ Ciphertext<DCRTPoly> BlindSender::computeSimilarityMatrix(vector<Ciphertext<DCRT
   size_t chunksPerVector = VECTOR_DIM / chunkLength;
   vector<Ciphertext<DCRTPoly>> matrixCipher(chunksPerVector);
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < chunksPerVector; i++) {
     matrixCipher[i] = computeSimilaritySerial(queryCipher[i], matrix, (i*chunkLength));
   }
 
+  MemoryUtils::ScopedLiveBytes productBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(matrixCipher));
+  TraceUtils::ScopedSpan span("matrix product sum", "reduction");
   for(size_t i = 1; i < chunksPerVector; i++) {
     cc->EvalAddInPlace(matrixCipher[0], matrixCipher[i]);
   }
@@ -84,11 +98,15 @@ Ciphertext<DCRTPoly> BlindSender::computeSimilarityMatrix(vector<Ciphertext<DCRT
 
 Ciphertext<DCRTPoly> BlindSender::computeSimilaritySerial(Ciphertext<DCRTPoly> &queryCipher, size_t matrix, size_t index) {
 
-  string filepath = "serial/db_blind/matrix" + to_string(matrix) + "/batch" + to_string(index) + ".bin";
+  string filepath = serialRoot + "db_blind/matrix" + to_string(matrix) + "/batch" + to_string(index) + ".bin";
   Ciphertext<DCRTPoly> databaseCipher;
-  if (Serial::DeserializeFromFile(filepath, databaseCipher, SerType::BINARY) == false) {
-    cerr << "Error: cannot deserialize from \"" << filepath << "\"" << endl;
+  {
+    TraceUtils::ScopedSpan span("DeserializeFromFile", "load");
+    if (OpenFHEWrapper::deserializeCipherFromFile(cc, filepath, databaseCipher) == false) {
+      cerr << "Error: cannot deserialize from \"" << filepath << "\"" << endl;
+    }
   }
 
+  TraceUtils::ScopedSpan span("EvalMultNoRelin", "multiply");
   return cc->EvalMultNoRelin(queryCipher, databaseCipher);
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "../../include/sender_compact.h"
+
+// implementation of functions declared in sender_compact.h
+
+// -------------------- CONSTRUCTOR --------------------
+
+CompactSender::CompactSender(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam,
+               size_t vectorParam)
+    : HersSender(ccParam, pkParam, vectorParam) {}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+vector<Ciphertext<DCRTPoly>> CompactSender::computeSimilarity(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+
+  vector<Ciphertext<DCRTPoly>> expandedCipher = prepareQuery(queryCipher);
+  return HersSender::computeSimilarity(expandedCipher);
+}
+
+// -------------------- PROTECTED FUNCTIONS --------------------
+
+vector<Ciphertext<DCRTPoly>> CompactSender::prepareQuery(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  vector<Ciphertext<DCRTPoly>> expandedCipher = expandQuery(queryCipher[0]);
+  TraceUtils::recordSpan("query expansion", "rotation", start, chrono::steady_clock::now());
+  MemoryUtils::samplePhase("query expansion");
+
+  return expandedCipher;
+}
+
+// generates the same ciphertexts as calling generateQueryHelper for every index
+// all rotations of the query share one precomputation and every product shares one mask
+vector<Ciphertext<DCRTPoly>> CompactSender::expandQuery(Ciphertext<DCRTPoly> &queryCipher) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  size_t cyclotomicOrder = 2 * cc->GetRingDimension(); // needed for fast hoisted rotations
+
+  // mask isolates the first slot of every VECTOR_DIM-length segment
+  vector<double> mask(batchSize, 0.0);
+  for(size_t i = 0; i < batchSize; i += VECTOR_DIM) {
+    mask[i] = 1.0;
+  }
+  Plaintext maskPtxt = cc->MakeCKKSPackedPlaintext(mask);
+
+  shared_ptr<vector<DCRTPoly>> queryPrecomp;
+  {
+    TraceUtils::ScopedSpan span("EvalFastRotationPrecompute", "rotation");
+    queryPrecomp = cc->EvalFastRotationPrecompute(queryCipher);
+  }
+
+  vector<Ciphertext<DCRTPoly>> expandedCipher(VECTOR_DIM);
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < VECTOR_DIM; i++) {
+    // rotating by i moves dimension i of every replica to the first slot of its segment
+    Ciphertext<DCRTPoly> rotatedCipher;
+    if(i == 0) {
+      rotatedCipher = queryCipher;
+    } else {
+      TraceUtils::ScopedSpan span("EvalFastRotation", "rotation");
+      rotatedCipher = cc->EvalFastRotation(queryCipher, i, cyclotomicOrder, queryPrecomp);
+    }
+
+    {
+      TraceUtils::ScopedSpan span("EvalMult mask", "multiply");
+      rotatedCipher = cc->EvalMult(rotatedCipher, maskPtxt);
+      cc->RescaleInPlace(rotatedCipher);
+    }
+
+    // add and rotate to fill all slots with that dimension's value
+    TraceUtils::ScopedSpan span("EvalSum", "rotation");
+    expandedCipher[i] = cc->EvalSum(rotatedCipher, VECTOR_DIM);
+  }
+
+  return expandedCipher;
+}
@@ -12,23 +12,20 @@ DiagonalSender::DiagonalSender(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPo
 vector<Ciphertext<DCRTPoly>> DiagonalSender::computeSimilarity(vector<Ciphertext<DCRTPoly>> &queryCipher) {
 
   size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
-  size_t cyclotomicOrder = 2 * cc->GetRingDimension(); // needed for fast hoisted rotations
   size_t numMatrices = ceil(double(numVectors) / double(batchSize));
   vector<Ciphertext<DCRTPoly>> similarityCipher(numMatrices);
 
   // generate all rotations of batched query vector
-  vector<Ciphertext<DCRTPoly>> rotatedQueryCipher(VECTOR_DIM);
-  rotatedQueryCipher[0] = queryCipher[0];
-  shared_ptr<vector<DCRTPoly>> queryPrecomp = cc->EvalFastRotationPrecompute(queryCipher[0]); // needed for fast hoisted rotations
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for(size_t i = 1; i < VECTOR_DIM; i++) {
-    rotatedQueryCipher[i] = cc->EvalFastRotation(queryCipher[0], i, cyclotomicOrder, queryPrecomp);
-  }
+  vector<Ciphertext<DCRTPoly>> rotatedQueryCipher = prepareQuery(queryCipher);
+
+  // rotated query ciphertexts stay resident for the whole similarity computation
+  MemoryUtils::ScopedLiveBytes rotatedBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(rotatedQueryCipher));
 
   for(size_t m = 0; m < numMatrices; m++) {
     similarityCipher[m] = computeSimilarityMatrix(rotatedQueryCipher, m);
   }
 
+  MemoryUtils::samplePhase("similarity");
   return similarityCipher;
 }
 
@@ -36,13 +33,16 @@ Ciphertext<DCRTPoly> DiagonalSender::membershipScenario(vector<Ciphertext<DCRTPo
 
   // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
   
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < scoreCipher.size(); i++) {
     scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
   }
+  MemoryUtils::samplePhase("comparison");
   
   // sum up all values into single result value at first slot of first cipher
+  TraceUtils::ScopedSpan span("membership sum", "reduction");
   Ciphertext<DCRTPoly> membershipCipher = cc->EvalAddManyInPlace(scoreCipher);
   membershipCipher = cc->EvalSum(membershipCipher, cc->GetEncodingParams()->GetBatchSize());
 
@@ -53,42 +53,97 @@ vector<Ciphertext<DCRTPoly>> DiagonalSender::indexScenario(vector<Ciphertext<DCR
 
   // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
-  
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for(size_t i = 0; i < scoreCipher.size(); i++) {
-    scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
-  }
-  
-  return scoreCipher;
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+
+  return compareScores(scoreCipher);
 }
 
 // -------------------- PROTECTED FUNCTIONS --------------------
+vector<Ciphertext<DCRTPoly>> DiagonalSender::prepareQuery(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+
+  size_t cyclotomicOrder = 2 * cc->GetRingDimension(); // needed for fast hoisted rotations
+
+  vector<Ciphertext<DCRTPoly>> rotatedQueryCipher(VECTOR_DIM);
+  rotatedQueryCipher[0] = queryCipher[0];
+  shared_ptr<vector<DCRTPoly>> queryPrecomp;
+  {
+    TraceUtils::ScopedSpan span("EvalFastRotationPrecompute", "rotation");
+    queryPrecomp = cc->EvalFastRotationPrecompute(queryCipher[0]); // needed for fast hoisted rotations
+  }
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 1; i < VECTOR_DIM; i++) {
+    TraceUtils::ScopedSpan span("EvalFastRotation", "rotation");
+    rotatedQueryCipher[i] = cc->EvalFastRotation(queryCipher[0], i, cyclotomicOrder, queryPrecomp);
+  }
+
+  return rotatedQueryCipher;
+}
+
 Ciphertext<DCRTPoly> DiagonalSender::computeSimilarityMatrix(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t matrix) {
 
   vector<Ciphertext<DCRTPoly>> scoreCipher(VECTOR_DIM);
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < VECTOR_DIM; i++) {
     scoreCipher[i] = computeSimilarityThread(queryCipher[i], matrix, i);
   }
 
-  for(size_t i = 1; i < VECTOR_DIM; i++) {
-    cc->EvalAddInPlace(scoreCipher[0], scoreCipher[i]);
+  MemoryUtils::ScopedLiveBytes productBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+  {
+    TraceUtils::ScopedSpan span("matrix product sum", "reduction");
+    for(size_t i = 1; i < VECTOR_DIM; i++) {
+      cc->EvalAddInPlace(scoreCipher[0], scoreCipher[i]);
+    }
   }
 
-  cc->RelinearizeInPlace(scoreCipher[0]);
-  cc->RescaleInPlace(scoreCipher[0]);
+  {
+    TraceUtils::ScopedSpan span("Relinearize + Rescale", "multiply");
+    cc->RelinearizeInPlace(scoreCipher[0]);
+    cc->RescaleInPlace(scoreCipher[0]);
+  }
 
+  maskTombstones(scoreCipher[0], serialRoot, matrix);
   return scoreCipher[0];
 }
 
-Ciphertext<DCRTPoly> DiagonalSender::computeSimilarityThread(Ciphertext<DCRTPoly> &queryCipher, size_t matrix, size_t index) {
+Ciphertext<DCRTPoly> DiagonalSender::loadDatabaseCipher(size_t matrix, size_t index) {
+  return loadDiagonalCipher(serialRoot, matrix, index);
+}
 
-  string filepath = "serial/db_diagonal/index" + to_string(matrix * VECTOR_DIM + index) + ".bin";
+Ciphertext<DCRTPoly> DiagonalSender::loadDiagonalCipher(const string &root, size_t matrix, size_t index) {
+
+  string filepath = root + "db_diagonal/index" + to_string(matrix * VECTOR_DIM + index) + ".bin";
   Ciphertext<DCRTPoly> databaseCipher;
-  if (Serial::DeserializeFromFile(filepath, databaseCipher, SerType::BINARY) == false) {
+  TraceUtils::ScopedSpan span("DeserializeFromFile", "load");
+  if (OpenFHEWrapper::deserializeCipherFromFile(cc, filepath, databaseCipher) == false) {
     cerr << "Error: cannot deserialize from \"" << filepath << "\"" << endl;
   }
+  return databaseCipher;
+}
+
+Ciphertext<DCRTPoly> DiagonalSender::combineProducts(vector<Ciphertext<DCRTPoly>> &productCipher) {
+
+  {
+    TraceUtils::ScopedSpan span("matrix product sum", "reduction");
+    for(size_t i = 1; i < productCipher.size(); i++) {
+      cc->EvalAddInPlace(productCipher[0], productCipher[i]);
+    }
+  }
+
+  TraceUtils::ScopedSpan span("Relinearize + Rescale", "multiply");
+  cc->RelinearizeInPlace(productCipher[0]);
+  cc->RescaleInPlace(productCipher[0]);
+  return productCipher[0];
+}
+
+string DiagonalSender::galleryDirectory() {
+  return "db_diagonal/";
+}
+
+Ciphertext<DCRTPoly> DiagonalSender::computeSimilarityThread(Ciphertext<DCRTPoly> &queryCipher, size_t matrix, size_t index) {
+
+  Ciphertext<DCRTPoly> databaseCipher = loadDatabaseCipher(matrix, index);
 
+  TraceUtils::ScopedSpan span("EvalMultNoRelin", "multiply");
   return cc->EvalMultNoRelin(queryCipher, databaseCipher);
 }
\ No newline at end of file
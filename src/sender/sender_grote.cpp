@@ -19,15 +19,18 @@ Ciphertext<DCRTPoly> GroteSender::membershipScenario(vector<Ciphertext<DCRTPoly>
 
     // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
   
   vector<Ciphertext<DCRTPoly>> colCipher = alphaNormColumns(scoreCipher, ALPHA_DEPTH, rowLength);
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < scoreCipher.size(); i++) {
     scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
   }
+  MemoryUtils::samplePhase("comparison");
   
   // sum up all values into single result value at first slot of first cipher
+  TraceUtils::ScopedSpan span("membership sum", "reduction");
   Ciphertext<DCRTPoly> membershipCipher = cc->EvalAddManyInPlace(scoreCipher);
   membershipCipher = cc->EvalSum(membershipCipher, cc->GetEncodingParams()->GetBatchSize());
 
@@ -38,13 +41,21 @@ Ciphertext<DCRTPoly> GroteSender::membershipScenario(vector<Ciphertext<DCRTPoly>
 vector<Ciphertext<DCRTPoly>> 
 GroteSender::indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) {
 
+  // compute similarity scores between query and database
+  vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+
+  return compareScores(scoreCipher);
+}
+
+
+vector<Ciphertext<DCRTPoly>>
+GroteSender::compareScores(vector<Ciphertext<DCRTPoly>> &scoreCipher) {
+
   // row length is the power of 2 closest to sqrt(batchSize)
   // dividing scores into square matrix as close as possible
   size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
   size_t rowLength = pow(2.0, ceil(log2(batchSize) / 2.0));
-  
-  // compute similarity scores between query and database
-  vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
 
   // compute row and column maxes for group testing
   vector<Ciphertext<DCRTPoly>> rowCipher = alphaNormRows(scoreCipher, ALPHA_DEPTH, rowLength);
@@ -57,16 +68,18 @@ GroteSender::indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) {
     adjustedThreshold = adjustedThreshold * adjustedThreshold;
   }
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < rowCipher.size(); i++) {
     rowCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, rowCipher[i], adjustedThreshold, COMP_DEPTH);
   }
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < colCipher.size(); i++) {
     colCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, colCipher[i], adjustedThreshold, COMP_DEPTH);
   }
 
+  MemoryUtils::samplePhase("comparison");
+
   // return boolean (0/1) values dictating which rows and columns contain matches
   rowCipher.insert(rowCipher.end(), colCipher.begin(), colCipher.end());
   return rowCipher;
@@ -16,11 +16,15 @@ vector<Ciphertext<DCRTPoly>> HersSender::computeSimilarity(vector<Ciphertext<DCR
   size_t ciphersNeeded = ceil(double(numVectors) / double(batchSize));
   vector<Ciphertext<DCRTPoly>> similarityCipher(ciphersNeeded);
 
+  // expanded query ciphertexts stay resident for the whole similarity computation
+  MemoryUtils::ScopedLiveBytes queryBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(queryCipher));
+
   // note: parallelizing this loop seems to decrease performance, guessing due to nesting threads inside the helper func
   for(size_t i = 0; i < ciphersNeeded; i++) {
-    similarityCipher[i] = computeSimilarityHelper(i, queryCipher);
+    similarityCipher[i] = computeSimilarityMatrix(queryCipher, i);
   }
 
+  MemoryUtils::samplePhase("similarity");
   return similarityCipher;
 }
 
@@ -29,13 +33,9 @@ vector<Ciphertext<DCRTPoly>> HersSender::indexScenario(vector<Ciphertext<DCRTPol
 
   // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
-  
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
-  for(size_t i = 0; i < scoreCipher.size(); i++) {
-    scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
-  }
-  
-  return scoreCipher;
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+
+  return compareScores(scoreCipher);
 }
 
 
@@ -43,19 +43,289 @@ Ciphertext<DCRTPoly> HersSender::membershipScenario(vector<Ciphertext<DCRTPoly>>
 
   // compute similarity scores between query and database
   vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
   
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < scoreCipher.size(); i++) {
     scoreCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH);
   }
+  MemoryUtils::samplePhase("comparison");
   
   // sum up all values into single result value at first slot of first cipher
+  TraceUtils::ScopedSpan span("membership sum", "reduction");
   Ciphertext<DCRTPoly> membershipCipher = cc->EvalAddManyInPlace(scoreCipher);
   membershipCipher = cc->EvalSum(membershipCipher, cc->GetEncodingParams()->GetBatchSize());
 
   return membershipCipher;
 }
 
+Ciphertext<DCRTPoly> HersSender::membershipScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t sinceEpoch) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+
+  vector<size_t> matrices;
+  vector<Ciphertext<DCRTPoly>> indexCipher = indexScenario(queryCipher, sinceEpoch, matrices);
+  if (indexCipher.empty()) {
+    return cc->Encrypt(pk, cc->MakeCKKSPackedPlaintext(vector<double>(batchSize, 0.0)));
+  }
+
+  TraceUtils::ScopedSpan span("membership sum", "reduction");
+  Ciphertext<DCRTPoly> membershipCipher = cc->EvalAddManyInPlace(indexCipher);
+  membershipCipher = cc->EvalSum(membershipCipher, batchSize);
+
+  return membershipCipher;
+}
+
+// cost scales with the number of matrices changed since the epoch, as the query is prepared once
+vector<Ciphertext<DCRTPoly>> HersSender::indexScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, size_t sinceEpoch,
+                                                       vector<size_t> &matrices) {
+
+  vector<size_t> epochs = readEpochs();
+  matrices.clear();
+  for(size_t m = 0; m < epochs.size(); m++) {
+    if (epochs[m] > sinceEpoch) {
+      matrices.push_back(m);
+    }
+  }
+  if (matrices.empty()) {
+    return vector<Ciphertext<DCRTPoly>>();
+  }
+
+  vector<Ciphertext<DCRTPoly>> preparedCipher = prepareQuery(queryCipher);
+  MemoryUtils::ScopedLiveBytes preparedBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(preparedCipher));
+
+  vector<Ciphertext<DCRTPoly>> scoreCipher(matrices.size());
+  for(size_t i = 0; i < matrices.size(); i++) {
+    scoreCipher[i] = computeSimilarityMatrix(preparedCipher, matrices[i]);
+  }
+  MemoryUtils::samplePhase("similarity");
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+
+  return compareScores(scoreCipher);
+}
+
+
+size_t HersSender::latestEpoch() {
+  vector<size_t> epochs = readEpochs();
+  return epochs.empty() ? 0 : *max_element(epochs.begin(), epochs.end());
+}
+
+// similarity of the next wave is only started once the comparisons of the previous wave have been emitted
+void HersSender::indexScenarioStream(vector<Ciphertext<DCRTPoly>> &queryCipher, const IndexCallback &emit) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  size_t numMatrices = ceil(double(numVectors) / double(batchSize));
+
+  vector<Ciphertext<DCRTPoly>> preparedCipher = prepareQuery(queryCipher);
+  MemoryUtils::ScopedLiveBytes preparedBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(preparedCipher));
+
+  for(size_t wave = 0; wave < numMatrices; wave += STREAM_WAVE_MATRICES) {
+    size_t waveLength = min(STREAM_WAVE_MATRICES, numMatrices - wave);
+
+    vector<Ciphertext<DCRTPoly>> scoreCipher(waveLength);
+    for(size_t i = 0; i < waveLength; i++) {
+      scoreCipher[i] = computeSimilarityMatrix(preparedCipher, wave + i);
+    }
+    MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+
+    #pragma omp parallel for num_threads(ThreadBudget::cores())
+    for(size_t i = 0; i < waveLength; i++) {
+      emit(wave + i, OpenFHEWrapper::chebyshevCompare(cc, scoreCipher[i], MATCH_THRESHOLD, COMP_DEPTH));
+    }
+  }
+  MemoryUtils::samplePhase("comparison");
+}
+
+// matrices are processed one at a time, so only one matrix of gallery ciphers is resident at once
+vector<vector<Ciphertext<DCRTPoly>>> HersSender::indexScenarioBatch(vector<vector<Ciphertext<DCRTPoly>>> &queryBatch) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  size_t numMatrices = ceil(double(numVectors) / double(batchSize));
+  size_t numQueries = queryBatch.size();
+
+  vector<vector<Ciphertext<DCRTPoly>>> preparedBatch(numQueries);
+  for(size_t q = 0; q < numQueries; q++) {
+    preparedBatch[q] = prepareQuery(queryBatch[q]);
+  }
+
+  vector<vector<Ciphertext<DCRTPoly>>> scoreBatch(numQueries, vector<Ciphertext<DCRTPoly>>(numMatrices));
+  for(size_t m = 0; m < numMatrices; m++) {
+    vector<vector<Ciphertext<DCRTPoly>>> productBatch(numQueries, vector<Ciphertext<DCRTPoly>>(VECTOR_DIM));
+
+    #pragma omp parallel for num_threads(ThreadBudget::cores())
+    for(size_t i = 0; i < VECTOR_DIM; i++) {
+      Ciphertext<DCRTPoly> databaseCipher = loadDatabaseCipher(m, i);
+      TraceUtils::ScopedSpan span("EvalMultNoRelin (batch)", "multiply");
+      for(size_t q = 0; q < numQueries; q++) {
+        productBatch[q][i] = cc->EvalMultNoRelin(preparedBatch[q][i], databaseCipher);
+      }
+    }
+
+    for(size_t q = 0; q < numQueries; q++) {
+      scoreBatch[q][m] = combineProducts(productBatch[q]);
+      maskTombstones(scoreBatch[q][m], serialRoot, m);
+    }
+  }
+  MemoryUtils::samplePhase("similarity");
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t k = 0; k < numQueries * numMatrices; k++) {
+    Ciphertext<DCRTPoly> &scoreCipher = scoreBatch[k / numMatrices][k % numMatrices];
+    scoreCipher = OpenFHEWrapper::chebyshevCompare(cc, scoreCipher, MATCH_THRESHOLD, COMP_DEPTH);
+  }
+  MemoryUtils::samplePhase("comparison");
+
+  return scoreBatch;
+}
+
+// encodes the best match of each block of slots into the block's leader slot
+// leader holds 2 * (cipher * blockLength + offset + 1) of its best match, leader + 1 its maximum score
+// and leader + 2 twice the number of matches within ARGMAX_MARGIN of that maximum
+Ciphertext<DCRTPoly> HersSender::argmaxScenario(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+
+  // compute similarity scores between query and database
+  vector<Ciphertext<DCRTPoly>> scoreCipher = computeSimilarity(queryCipher);
+  MemoryUtils::ScopedLiveBytes scoreBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+
+  // raw scores must never be returned in place of the argmax, so an uncoverable database gets zeros
+  size_t blockLength = OpenFHEWrapper::argmaxBlockLength(scoreCipher.size());
+  if (blockLength == 0) {
+    cerr << "Error: ARGMAX_ROUNDS cannot cover " << scoreCipher.size() << " result ciphers" << endl;
+    return cc->Encrypt(pk, cc->MakeCKKSPackedPlaintext(vector<double>(batchSize, 0.0)));
+  }
+
+  vector<double> leaderMask(batchSize, 0.0);
+  for(size_t i = 0; i < batchSize; i += blockLength) {
+    leaderMask[i] = 1.0;
+  }
+  Plaintext leaderPtxt = cc->MakeCKKSPackedPlaintext(leaderMask);
+
+  // isolate the maximum of each block at its leader and broadcast it back across the block
+  Ciphertext<DCRTPoly> leaderMax = argmaxTournament(scoreCipher, blockLength);
+  leaderMax = cc->EvalMult(leaderMax, leaderPtxt);
+  cc->RescaleInPlace(leaderMax);
+  Ciphertext<DCRTPoly> blockMax = leaderMax;
+  for(size_t k = 1; k < blockLength; k *= 2) {
+    blockMax = cc->EvalAdd(blockMax, cc->EvalRotate(blockMax, -int(k)));
+  }
+
+  // flag scores at their block maximum and weight the flags by their encoded index
+  vector<Ciphertext<DCRTPoly>> flagCipher(scoreCipher.size());
+  vector<Ciphertext<DCRTPoly>> encodedCipher(scoreCipher.size());
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < scoreCipher.size(); i++) {
+    vector<double> encoding(batchSize);
+    for(size_t j = 0; j < batchSize; j++) {
+      encoding[j] = double(i * blockLength + (j % blockLength) + 1);
+    }
+
+    flagCipher[i] = OpenFHEWrapper::chebyshevCompare(cc, cc->EvalSub(scoreCipher[i], blockMax), -ARGMAX_MARGIN, COMP_DEPTH, -2.5, 0.5);
+    encodedCipher[i] = cc->EvalMult(flagCipher[i], cc->MakeCKKSPackedPlaintext(encoding));
+    cc->RescaleInPlace(encodedCipher[i]);
+  }
+  MemoryUtils::samplePhase("comparison");
+
+  // sum flags and encoded indices of each block into its leader
+  TraceUtils::ScopedSpan span("argmax block sum", "reduction");
+  Ciphertext<DCRTPoly> countCipher = cc->EvalAddManyInPlace(flagCipher);
+  Ciphertext<DCRTPoly> argmaxCipher = cc->EvalAddManyInPlace(encodedCipher);
+  for(size_t k = 1; k < blockLength; k *= 2) {
+    countCipher = cc->EvalAdd(countCipher, cc->EvalRotate(countCipher, k));
+    argmaxCipher = cc->EvalAdd(argmaxCipher, cc->EvalRotate(argmaxCipher, k));
+  }
+
+  countCipher = cc->EvalMult(countCipher, leaderPtxt);
+  cc->RescaleInPlace(countCipher);
+  argmaxCipher = cc->EvalMult(argmaxCipher, leaderPtxt);
+  cc->RescaleInPlace(argmaxCipher);
+
+  argmaxCipher = cc->EvalAdd(argmaxCipher, cc->EvalRotate(leaderMax, -1));
+  argmaxCipher = cc->EvalAdd(argmaxCipher, cc->EvalRotate(countCipher, -2));
+  return argmaxCipher;
+}
+
+// -------------------- PROTECTED FUNCTIONS --------------------
+
+vector<Ciphertext<DCRTPoly>> HersSender::prepareQuery(vector<Ciphertext<DCRTPoly>> &queryCipher) {
+  return queryCipher;
+}
+
+Ciphertext<DCRTPoly> HersSender::computeSimilarityMatrix(vector<Ciphertext<DCRTPoly>> &preparedCipher, size_t matrix) {
+  Ciphertext<DCRTPoly> scoreCipher = computeSimilarityHelper(matrix, preparedCipher);
+  maskTombstones(scoreCipher, serialRoot, matrix);
+  return scoreCipher;
+}
+
+Ciphertext<DCRTPoly> HersSender::loadDatabaseCipher(size_t matrix, size_t index) {
+
+  string filepath = serialRoot + "db_hers/matrix" + to_string(matrix) + "/index" + to_string(index) + ".bin";
+  Ciphertext<DCRTPoly> databaseCipher;
+  TraceUtils::ScopedSpan span("DeserializeFromFile", "load");
+  if (OpenFHEWrapper::deserializeCipherFromFile(cc, filepath, databaseCipher) == false) {
+    cerr << "Error: cannot deserialize from \"" << filepath << "\"" << endl;
+  }
+  return databaseCipher;
+}
+
+// products are relinearized and rescaled individually, matching computeSimilarityHelper
+Ciphertext<DCRTPoly> HersSender::combineProducts(vector<Ciphertext<DCRTPoly>> &productCipher) {
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < productCipher.size(); i++) {
+    TraceUtils::ScopedSpan span("Relinearize + Rescale", "multiply");
+    cc->RelinearizeInPlace(productCipher[i]);
+    cc->RescaleInPlace(productCipher[i]);
+  }
+
+  TraceUtils::ScopedSpan span("matrix product sum", "reduction");
+  for(size_t i = 1; i < productCipher.size(); i++) {
+    cc->EvalAddInPlace(productCipher[0], productCipher[i]);
+  }
+  return productCipher[0];
+}
+
+string HersSender::galleryDirectory() {
+  return "db_hers/";
+}
+
+// the tombstone list is read per matrix, so deletions become visible to the next matrix evaluated
+void HersSender::maskTombstones(Ciphertext<DCRTPoly> &scoreCipher, const string &root, size_t matrix) {
+
+  if (!TOMBSTONE_MASKING) {
+    return;
+  }
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  set<size_t> tombstones = VectorUtils::readIndexSet(root + galleryDirectory() + TOMBSTONE_FILENAME);
+
+  vector<double> mask(batchSize, 1.0);
+  bool masked = false;
+  for(set<size_t>::iterator it = tombstones.lower_bound(matrix * batchSize); it != tombstones.end() && *it < (matrix + 1) * batchSize; it++) {
+    mask[*it % batchSize] = 0.0;
+    masked = true;
+  }
+  if (!masked) {
+    return;
+  }
+
+  TraceUtils::ScopedSpan span("tombstone mask", "multiply");
+  scoreCipher = cc->EvalMult(scoreCipher, cc->MakeCKKSPackedPlaintext(mask));
+  cc->RescaleInPlace(scoreCipher);
+}
+
+// the enroller writes epochs.txt only once a matrix is fully written, so its length is the committed matrix count
+// and matrices appended or compacted away since this sender was constructed are taken into account
+vector<size_t> HersSender::readEpochs() {
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+  vector<size_t> epochs = VectorUtils::readIndexList(serialRoot + galleryDirectory() + EPOCH_FILENAME);
+  if (epochs.empty()) {
+    epochs.resize(ceil(double(numVectors) / double(batchSize)), 0);
+  }
+  return epochs;
+}
+
 // -------------------- PRIVATE FUNCTIONS --------------------
 
 Ciphertext<DCRTPoly>
@@ -63,17 +333,22 @@ HersSender::computeSimilarityHelper(size_t matrixIndex, vector<Ciphertext<DCRTPo
 
   vector<Ciphertext<DCRTPoly>> scoreCipher(VECTOR_DIM);
 
-  #pragma omp parallel for num_threads(MAX_NUM_CORES)
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
   for(size_t i = 0; i < VECTOR_DIM; i++) {
     scoreCipher[i] = computeSimilaritySerial(matrixIndex, i, queryCipher[i]);
 
     // unnecessary operations placed here to match HERS paper approach
+    TraceUtils::ScopedSpan span("Relinearize + Rescale", "multiply");
     cc->RelinearizeInPlace(scoreCipher[i]);
     cc->RescaleInPlace(scoreCipher[i]);
   }
 
-  for(size_t i = 1; i < VECTOR_DIM; i++) {
-    cc->EvalAddInPlace(scoreCipher[0], scoreCipher[i]);
+  MemoryUtils::ScopedLiveBytes productBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(scoreCipher));
+  {
+    TraceUtils::ScopedSpan span("matrix product sum", "reduction");
+    for(size_t i = 1; i < VECTOR_DIM; i++) {
+      cc->EvalAddInPlace(scoreCipher[0], scoreCipher[i]);
+    }
   }
 
   // this is where operations should be instead according to novel approach
@@ -88,16 +363,43 @@ HersSender::computeSimilarityHelper(size_t matrixIndex, vector<Ciphertext<DCRTPo
 Ciphertext<DCRTPoly>
 HersSender::computeSimilaritySerial(size_t matrix, size_t index, Ciphertext<DCRTPoly> &queryCipher) {
 
-  string filepath = "serial/db_hers/matrix" + to_string(matrix) + "/index" + to_string(index) + ".bin";
-  Ciphertext<DCRTPoly> databaseCipher;
-  if (Serial::DeserializeFromFile(filepath, databaseCipher, SerType::BINARY) == false) {
-    cerr << "Error: cannot deserialize from \"" << filepath << "\"" << endl;
-  }
+  Ciphertext<DCRTPoly> databaseCipher = loadDatabaseCipher(matrix, index);
 
+  TraceUtils::ScopedSpan span("EvalMultNoRelin", "multiply");
   return cc->EvalMultNoRelin(queryCipher, databaseCipher);
 }
 
 
+// approximate-max tournament, first folding all score ciphers slot-wise and then across slots
+// the first slot of every block of blockLength slots ends up holding the maximum of that block
+Ciphertext<DCRTPoly>
+HersSender::argmaxTournament(vector<Ciphertext<DCRTPoly>> &scoreCipher, size_t blockLength) {
+  TraceUtils::ScopedSpan span("argmax tournament", "comparison");
+
+  vector<Ciphertext<DCRTPoly>> roundCipher = scoreCipher;
+  while(roundCipher.size() > 1) {
+    vector<Ciphertext<DCRTPoly>> nextCipher((roundCipher.size() + 1) / 2);
+
+    #pragma omp parallel for num_threads(ThreadBudget::cores())
+    for(size_t i = 0; i < roundCipher.size() / 2; i++) {
+      nextCipher[i] = OpenFHEWrapper::approxMax(cc, roundCipher[2 * i], roundCipher[2 * i + 1], ARGMAX_STEP_DEPTH);
+    }
+    if(roundCipher.size() % 2 == 1) {
+      nextCipher.back() = roundCipher.back();
+    }
+
+    roundCipher = nextCipher;
+  }
+
+  Ciphertext<DCRTPoly> maxCipher = roundCipher[0];
+  for(size_t k = 1; k < blockLength; k *= 2) {
+    maxCipher = OpenFHEWrapper::approxMax(cc, maxCipher, cc->EvalRotate(maxCipher, k), ARGMAX_STEP_DEPTH);
+  }
+
+  return maxCipher;
+}
+
+
 Ciphertext<DCRTPoly> HersSender::generateQueryHelper(Ciphertext<DCRTPoly> &queryCipher, size_t index){
   size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
 
@@ -107,11 +409,16 @@ Ciphertext<DCRTPoly> HersSender::generateQueryHelper(Ciphertext<DCRTPoly> &query
     mask[i] = 1.0;
   }
   Plaintext maskPtxt = cc->MakeCKKSPackedPlaintext(mask);
-  queryCipher = cc->EvalMult(queryCipher, maskPtxt);
-  cc->RescaleInPlace(queryCipher);
+  Ciphertext<DCRTPoly> maskedCipher;
+  {
+    TraceUtils::ScopedSpan span("EvalMult mask", "multiply");
+    maskedCipher = cc->EvalMult(queryCipher, maskPtxt);
+    cc->RescaleInPlace(maskedCipher);
+  }
 
   // add and rotate to fill all slots with that specified value
-  return cc->EvalSum(queryCipher, VECTOR_DIM);
+  TraceUtils::ScopedSpan span("EvalSum", "rotation");
+  return cc->EvalSum(maskedCipher, VECTOR_DIM);
 }
 
 
@@ -120,6 +427,7 @@ vector<Ciphertext<DCRTPoly>> HersSender::alphaNormRows(vector<Ciphertext<DCRTPol
   vector<Ciphertext<DCRTPoly>> alphaCipher(scoreCipher);
 
   for(size_t i = 0; i < alphaCipher.size(); i++) {
+    TraceUtils::ScopedSpan span("alphaNormRows", "multiply");
     for(size_t a = 0; a < alpha; a++) {
       cc->EvalSquareInPlace(alphaCipher[i]);
       cc->RescaleInPlace(alphaCipher[i]);
@@ -147,6 +455,7 @@ vector<Ciphertext<DCRTPoly>> HersSender::alphaNormColumns(vector<Ciphertext<DCRT
   size_t outputSlot;
 
   for(size_t i = 0; i < alphaCipher.size(); i++) {
+    TraceUtils::ScopedSpan span("alphaNormColumns", "multiply");
 
     // perform exponential step of alpha norm operation
     for(size_t a = 0; a < alpha; a++) {
@@ -0,0 +1,97 @@
+#include "../../include/sender_multi.h"
+
+// implementation of functions declared in sender_multi.h
+
+// -------------------- CONSTRUCTOR --------------------
+
+MultiGallerySender::MultiGallerySender(CryptoContext<DCRTPoly> ccParam, PublicKey<DCRTPoly> pkParam)
+    : DiagonalSender(ccParam, pkParam, 0) {}
+
+// -------------------- PUBLIC FUNCTIONS --------------------
+
+// numVectors tracks the largest gallery, so that the inherited response finalization bounds every gallery's results
+void MultiGallerySender::addGallery(const string &name, const string &root, size_t galleryVectors) {
+  galleries[name] = {root, galleryVectors};
+  numVectors = max(numVectors, galleryVectors);
+}
+
+
+vector<string> MultiGallerySender::galleryNames() {
+  vector<string> names;
+  for(map<string, Gallery>::iterator it = galleries.begin(); it != galleries.end(); it++) {
+    names.push_back(it->first);
+  }
+  return names;
+}
+
+// the 511 hoisted rotations are the costliest gallery-independent step, so they are computed once for all galleries
+// comparisons of all galleries then run in a single parallel loop
+map<string, MultiGallerySender::GalleryResult>
+MultiGallerySender::multiGalleryScenario(vector<Ciphertext<DCRTPoly>> &queryCipher, const vector<string> &names) {
+
+  size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
+
+  vector<Ciphertext<DCRTPoly>> rotatedQueryCipher = prepareQuery(queryCipher);
+  MemoryUtils::ScopedLiveBytes rotatedBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(rotatedQueryCipher));
+
+  // every requested gallery's matrices, each gallery's results forming a contiguous range
+  vector<string> requested;
+  vector<size_t> firstCipher;
+  vector<pair<string, size_t>> matrices;
+  for(size_t g = 0; g < names.size(); g++) {
+    map<string, Gallery>::iterator gallery = galleries.find(names[g]);
+    if (gallery == galleries.end()) {
+      cerr << "Error: unknown gallery \"" << names[g] << "\"" << endl;
+      continue;
+    }
+    requested.push_back(names[g]);
+    firstCipher.push_back(matrices.size());
+    size_t numMatrices = ceil(double(gallery->second.numVectors) / double(batchSize));
+    for(size_t m = 0; m < numMatrices; m++) {
+      matrices.push_back(make_pair(gallery->second.root, m));
+    }
+  }
+  firstCipher.push_back(matrices.size());
+
+  vector<Ciphertext<DCRTPoly>> scoreCipher(matrices.size());
+  for(size_t k = 0; k < matrices.size(); k++) {
+    scoreCipher[k] = computeGalleryMatrix(rotatedQueryCipher, matrices[k].first, matrices[k].second);
+  }
+  MemoryUtils::samplePhase("similarity");
+
+  vector<Ciphertext<DCRTPoly>> indexCipher = compareScores(scoreCipher);
+
+  // membership of each gallery is summed from its index results, as in the diagonal membership scenario
+  map<string, GalleryResult> results;
+  TraceUtils::ScopedSpan span("membership sum", "reduction");
+  for(size_t g = 0; g < requested.size(); g++) {
+    GalleryResult &result = results[requested[g]];
+    result.indexCipher.assign(indexCipher.begin() + firstCipher[g], indexCipher.begin() + firstCipher[g + 1]);
+
+    vector<Ciphertext<DCRTPoly>> sumCipher = result.indexCipher;
+    result.membershipCipher = cc->EvalAddManyInPlace(sumCipher);
+    result.membershipCipher = cc->EvalSum(result.membershipCipher, batchSize);
+  }
+
+  return results;
+}
+
+// -------------------- PRIVATE FUNCTIONS --------------------
+
+Ciphertext<DCRTPoly> MultiGallerySender::computeGalleryMatrix(vector<Ciphertext<DCRTPoly>> &rotatedQueryCipher,
+                                                              const string &root, size_t matrix) {
+
+  vector<Ciphertext<DCRTPoly>> productCipher(VECTOR_DIM);
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for(size_t i = 0; i < VECTOR_DIM; i++) {
+    Ciphertext<DCRTPoly> databaseCipher = loadDiagonalCipher(root, matrix, i);
+    TraceUtils::ScopedSpan span("EvalMultNoRelin", "multiply");
+    productCipher[i] = cc->EvalMultNoRelin(rotatedQueryCipher[i], databaseCipher);
+  }
+
+  MemoryUtils::ScopedLiveBytes productBytes(MemoryUtils::CIPHERTEXT_MEMORY, MemoryUtils::cipherBytes(productCipher));
+  Ciphertext<DCRTPoly> scoreCipher = combineProducts(productCipher);
+  maskTombstones(scoreCipher, root, matrix);
+  return scoreCipher;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#include "../include/thread_budget.h"
+
+namespace {
+
+thread_local size_t threadCores = MAX_NUM_CORES;
+
+}
+
+size_t ThreadBudget::cores() {
+  return threadCores;
+}
+
+
+void ThreadBudget::setCores(size_t numCores) {
+  if (numCores < 1) {
+    numCores = 1;
+  }
+  if (numCores > MAX_NUM_CORES) {
+    numCores = MAX_NUM_CORES;
+  }
+  threadCores = numCores;
+}
+
+// -------------------- SCOPED BUDGET --------------------
+
+ThreadBudget::ScopedBudget::ScopedBudget(size_t numCores) : previousCores(cores()) {
+  setCores(numCores);
+}
+
+ThreadBudget::ScopedBudget::~ScopedBudget() {
+  threadCores = previousCores;
+}
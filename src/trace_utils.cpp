@@ -0,0 +1,90 @@
+#include "../include/trace_utils.h"
+
+namespace {
+
+mutex traceMutex;
+vector<TraceUtils::TraceEvent> traceEvents;
+chrono::steady_clock::time_point traceOrigin = chrono::steady_clock::now();
+atomic<size_t> nextThreadID(0);
+
+}
+
+void TraceUtils::beginQuery() {
+  lock_guard<mutex> lock(traceMutex);
+  traceEvents.clear();
+  traceOrigin = chrono::steady_clock::now();
+}
+
+
+void TraceUtils::recordSpan(const char *name, const char *category,
+                            chrono::steady_clock::time_point start, chrono::steady_clock::time_point end) {
+  if (!ENABLE_TRACING) {
+    return;
+  }
+
+  size_t tid = threadID();
+  lock_guard<mutex> lock(traceMutex);
+  traceEvents.push_back({
+    name,
+    category,
+    tid,
+    chrono::duration_cast<chrono::microseconds>(start - traceOrigin).count(),
+    chrono::duration_cast<chrono::microseconds>(end - start).count()
+  });
+}
+
+
+bool TraceUtils::writeTrace(const string &filepath) {
+  ofstream traceStream(filepath, ios::out | ios::trunc);
+  if (!traceStream.is_open()) {
+    cerr << "Error: cannot write trace to \"" << filepath << "\"" << endl;
+    return false;
+  }
+
+  lock_guard<mutex> lock(traceMutex);
+
+  // name each thread lane so that the main thread stands apart from the worker threads
+  size_t maxThread = 0;
+  for (const auto &event : traceEvents) {
+    maxThread = max(maxThread, event.threadID);
+  }
+
+  traceStream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (size_t t = 0; t <= maxThread && !traceEvents.empty(); t++) {
+    traceStream << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+                << ",\"args\":{\"name\":\"thread " << t << "\"}}";
+    first = false;
+  }
+  for (const auto &event : traceEvents) {
+    traceStream << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadID
+                << ",\"ts\":" << event.startMicros << ",\"dur\":" << event.durationMicros << "}";
+    first = false;
+  }
+  traceStream << "\n]}" << endl;
+  traceStream.close();
+
+  return true;
+}
+
+
+size_t TraceUtils::threadID() {
+  thread_local size_t id = nextThreadID++;
+  return id;
+}
+
+// -------------------- SCOPED SPAN --------------------
+
+TraceUtils::ScopedSpan::ScopedSpan(const char *nameParam, const char *categoryParam)
+    : name(nameParam), category(categoryParam) {
+  if (ENABLE_TRACING) {
+    start = chrono::steady_clock::now();
+  }
+}
+
+TraceUtils::ScopedSpan::~ScopedSpan() {
+  if (ENABLE_TRACING) {
+    recordSpan(name, category, start, chrono::steady_clock::now());
+  }
+}
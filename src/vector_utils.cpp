@@ -1,45 +1,184 @@
 #include "../include/vector_utils.h"
+#include "../include/thread_budget.h"
+#include <filesystem>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define VECTOR_UTILS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// number of matrix rows per block of the batched cosine scores, 64 rows of 512 doubles fit in L2
+const size_t SCORE_BLOCK_ROWS = 64;
+
+typedef double (*InnerProductKernel)(const double *, const double *, size_t);
+
+typedef void (*ThresholdKernel)(const double *, size_t, double, size_t, vector<size_t> &);
+
+double innerProductScalar(const double *x, const double *y, size_t n) {
+  double prod = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    prod += x[i] * y[i];
+  }
+  return prod;
+}
+
+void thresholdScalar(const double *values, size_t n, double threshold, size_t offset, vector<size_t> &indices) {
+  for (size_t i = 0; i < n; i++) {
+    if (values[i] >= threshold) {
+      indices.push_back(offset + i);
+    }
+  }
+}
+
+#ifdef VECTOR_UTILS_X86_DISPATCH
+
+__attribute__((target("avx2,fma")))
+double innerProductAvx2(const double *x, const double *y, size_t n) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+    acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), acc1);
+  }
+  acc0 = _mm256_add_pd(acc0, acc1);
+  __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+  double prod = _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+  for (; i < n; i++) {
+    prod += x[i] * y[i];
+  }
+  return prod;
+}
+
+__attribute__((target("avx512f")))
+double innerProductAvx512(const double *x, const double *y, size_t n) {
+  __m512d acc0 = _mm512_setzero_pd();
+  __m512d acc1 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), acc0);
+    acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), acc1);
+  }
+  double lanes[8];
+  _mm512_storeu_pd(lanes, _mm512_add_pd(acc0, acc1));
+  double prod = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+  for (; i < n; i++) {
+    prod += x[i] * y[i];
+  }
+  return prod;
+}
+
+// compares a vector of slots per instruction, visiting only the set bits of the resulting mask
+__attribute__((target("avx2")))
+void thresholdAvx2(const double *values, size_t n, double threshold, size_t offset, vector<size_t> &indices) {
+  const __m256d t = _mm256_set1_pd(threshold);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    unsigned mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), t, _CMP_GE_OQ))
+                  | (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i + 4), t, _CMP_GE_OQ)) << 4);
+    while (mask) {
+      indices.push_back(offset + i + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+  thresholdScalar(values + i, n - i, threshold, offset + i, indices);
+}
+
+__attribute__((target("avx512f")))
+void thresholdAvx512(const double *values, size_t n, double threshold, size_t offset, vector<size_t> &indices) {
+  const __m512d t = _mm512_set1_pd(threshold);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    unsigned mask = _mm512_cmp_pd_mask(_mm512_loadu_pd(values + i), t, _CMP_GE_OQ)
+                  | (unsigned(_mm512_cmp_pd_mask(_mm512_loadu_pd(values + i + 8), t, _CMP_GE_OQ)) << 8);
+    while (mask) {
+      indices.push_back(offset + i + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+  thresholdScalar(values + i, n - i, threshold, offset + i, indices);
+}
+
+#endif
+
+InnerProductKernel selectKernel(string &level) {
+#ifdef VECTOR_UTILS_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    level = "avx512";
+    return innerProductAvx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    level = "avx2";
+    return innerProductAvx2;
+  }
+#endif
+  level = "scalar";
+  return innerProductScalar;
+}
+
+// kernel is chosen once, on first use
+InnerProductKernel kernel(string *level = nullptr) {
+  static string selectedLevel;
+  static const InnerProductKernel selected = selectKernel(selectedLevel);
+  if (level) {
+    *level = selectedLevel;
+  }
+  return selected;
+}
+
+ThresholdKernel selectThresholdKernel() {
+#ifdef VECTOR_UTILS_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return thresholdAvx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return thresholdAvx2;
+  }
+#endif
+  return thresholdScalar;
+}
+
+ThresholdKernel thresholdKernel() {
+  static const ThresholdKernel selected = selectThresholdKernel();
+  return selected;
+}
+
+}
 
 /* Append the vector source onto the end of the vector dest, n times */
 void VectorUtils::concatenateVectors(vector<double> &dest,
-                                     vector<double> source, int n) {
+                                     const vector<double> &source, int n) {
   for (int i = 0; i < n; i++) {
     dest.insert(dest.end(), source.begin(), source.end());
   }
 }
 
 
-double VectorUtils::plaintextCosineSim(vector<double> x, vector<double> y) {
-  double xMag = 0.0;
-  double yMag = 0.0;
-  double innerProduct = 0.0;
-
+double VectorUtils::plaintextCosineSim(const vector<double> &x, const vector<double> &y) {
   if (x.size() != y.size()) {
     cerr << "Error: cannot compute cosine similarity between vectors of different dimension" << endl;
     return -1.0;
   }
 
-  for (size_t i = 0; i < x.size(); i++) {
-    xMag += (x[i] * x[i]);
-    yMag += (y[i] * y[i]);
-    innerProduct += (x[i] * y[i]);
-  }
+  InnerProductKernel dot = kernel();
+  double xMag = dot(x.data(), x.data(), x.size());
+  double yMag = dot(y.data(), y.data(), y.size());
+  double innerProduct = dot(x.data(), y.data(), x.size());
 
   return innerProduct / (sqrt(xMag) * sqrt(yMag));
 }
 
 
-double VectorUtils::plaintextMagnitude(vector<double> x, int vectorDim) {
-  double m = 0.0;
-  for (int i = 0; i < vectorDim; i++) {
-    m += (x[i] * x[i]);
-  }
-  m = sqrt(m);
-  return m;
+double VectorUtils::plaintextMagnitude(const vector<double> &x, int vectorDim) {
+  return sqrt(kernel()(x.data(), x.data(), vectorDim));
 }
 
 
-vector<double> VectorUtils::plaintextNormalize(vector<double> x, int vectorDim) {
+vector<double> VectorUtils::plaintextNormalize(const vector<double> &x, int vectorDim) {
   double m = plaintextMagnitude(x, vectorDim);
   vector<double> x_norm = x;
   if (m != 0) {
@@ -51,10 +190,183 @@ vector<double> VectorUtils::plaintextNormalize(vector<double> x, int vectorDim)
 }
 
 
-double VectorUtils::plaintextInnerProduct(vector<double> x, vector<double> y, int vectorDim) {
-  double prod = 0.0;
-  for (int i = 0; i < vectorDim; i++) {
-    prod += x[i] * y[i];
+double VectorUtils::plaintextInnerProduct(const vector<double> &x, const vector<double> &y, int vectorDim) {
+  return kernel()(x.data(), y.data(), vectorDim);
+}
+
+
+double VectorUtils::innerProduct(const double *x, const double *y, size_t n) {
+  return kernel()(x, y, n);
+}
+
+
+void VectorUtils::thresholdIndices(const double *values, size_t n, double threshold, size_t offset, vector<size_t> &indices) {
+  thresholdKernel()(values, n, threshold, offset, indices);
+}
+
+
+vector<size_t> VectorUtils::thresholdIndices(const vector<double> &values, double threshold) {
+  vector<size_t> indices;
+  thresholdKernel()(values.data(), values.size(), threshold, 0, indices);
+  return indices;
+}
+
+
+string VectorUtils::simdLevel() {
+  string level;
+  kernel(&level);
+  return level;
+}
+
+
+vector<double> VectorUtils::flattenVectors(const vector<vector<double>> &vectors, size_t vectorDim) {
+  vector<double> matrix(vectors.size() * vectorDim);
+  for (size_t i = 0; i < vectors.size(); i++) {
+    copy(vectors[i].begin(), vectors[i].begin() + vectorDim, matrix.begin() + i * vectorDim);
   }
-  return prod;
+  return matrix;
+}
+
+
+void VectorUtils::plaintextNormalizeBatch(vector<vector<double>> &vectors, size_t vectorDim) {
+  InnerProductKernel dot = kernel();
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for (size_t i = 0; i < vectors.size(); i++) {
+    double m = sqrt(dot(vectors[i].data(), vectors[i].data(), vectorDim));
+    if (m != 0) {
+      for (size_t j = 0; j < vectorDim; j++) {
+        vectors[i][j] /= m;
+      }
+    }
+  }
+}
+
+
+void VectorUtils::plaintextNormalizeBatch(vector<double> &matrix, size_t vectorDim) {
+  InnerProductKernel dot = kernel();
+  size_t numRows = matrix.size() / vectorDim;
+
+  #pragma omp parallel for num_threads(ThreadBudget::cores())
+  for (size_t i = 0; i < numRows; i++) {
+    double *row = matrix.data() + i * vectorDim;
+    double m = sqrt(dot(row, row, vectorDim));
+    if (m != 0) {
+      for (size_t j = 0; j < vectorDim; j++) {
+        row[j] /= m;
+      }
+    }
+  }
+}
+
+
+vector<vector<double>> VectorUtils::plaintextCosineScores(const vector<vector<double>> &queries,
+                                                          const vector<double> &matrix, size_t vectorDim) {
+  InnerProductKernel dot = kernel();
+  size_t numRows = matrix.size() / vectorDim;
+  size_t numBlocks = (numRows + SCORE_BLOCK_ROWS - 1) / SCORE_BLOCK_ROWS;
+
+  // normalize the queries once so only row magnitudes remain per score
+  vector<vector<double>> normalizedQueries(queries);
+  plaintextNormalizeBatch(normalizedQueries, vectorDim);
+
+  vector<vector<double>> scores(queries.size(), vector<double>(numRows));
+
+  // each block of rows stays in cache while every query is scored against it
+  #pragma omp parallel for num_threads(ThreadBudget::cores()) schedule(dynamic)
+  for (size_t b = 0; b < numBlocks; b++) {
+    size_t blockEnd = min(numRows, (b + 1) * SCORE_BLOCK_ROWS);
+    double rowMags[SCORE_BLOCK_ROWS];
+
+    for (size_t i = b * SCORE_BLOCK_ROWS; i < blockEnd; i++) {
+      const double *row = matrix.data() + i * vectorDim;
+      rowMags[i - b * SCORE_BLOCK_ROWS] = sqrt(dot(row, row, vectorDim));
+    }
+
+    for (size_t q = 0; q < normalizedQueries.size(); q++) {
+      const double *query = normalizedQueries[q].data();
+      for (size_t i = b * SCORE_BLOCK_ROWS; i < blockEnd; i++) {
+        scores[q][i] = dot(query, matrix.data() + i * vectorDim, vectorDim) / rowMags[i - b * SCORE_BLOCK_ROWS];
+      }
+    }
+  }
+
+  return scores;
+}
+
+
+VectorUtils::IdentityLayout VectorUtils::identityLayout(const vector<size_t> &identities, size_t blockLength) {
+  IdentityLayout layout;
+  layout.blockLength = blockLength;
+
+  map<size_t, vector<size_t>> identityTemplates;
+  for (size_t i = 0; i < identities.size(); i++) {
+    identityTemplates[identities[i]].push_back(i);
+  }
+
+  for (const auto &entry : identityTemplates) {
+    const vector<size_t> &templates = entry.second;
+    for (size_t start = 0; start < templates.size(); start += blockLength) {
+      layout.blockIdentity.push_back(entry.first);
+      for (size_t j = start; j < start + blockLength; j++) {
+        layout.positionTemplate.push_back(j < templates.size() ? long(templates[j]) : -1);
+      }
+    }
+  }
+
+  return layout;
+}
+
+
+vector<vector<double>> VectorUtils::applyIdentityLayout(const vector<vector<double>> &templates, const IdentityLayout &layout) {
+  size_t vectorDim = templates.empty() ? 0 : templates[0].size();
+  vector<vector<double>> laidOut(layout.positionTemplate.size(), vector<double>(vectorDim, 0.0));
+
+  for (size_t i = 0; i < layout.positionTemplate.size(); i++) {
+    if (layout.positionTemplate[i] >= 0) {
+      laidOut[i] = templates[layout.positionTemplate[i]];
+    }
+  }
+
+  return laidOut;
+}
+
+
+vector<size_t> VectorUtils::readIndexList(const string &filepath) {
+  vector<size_t> indices;
+  ifstream file(filepath);
+  size_t index;
+  while (file >> index) {
+    indices.push_back(index);
+  }
+  return indices;
+}
+
+
+set<size_t> VectorUtils::readIndexSet(const string &filepath) {
+  vector<size_t> indices = readIndexList(filepath);
+  return set<size_t>(indices.begin(), indices.end());
+}
+
+
+bool VectorUtils::writeIndexList(const string &filepath, const vector<size_t> &indices) {
+  string tempPath = filepath + ".tmp";
+  {
+    ofstream file(tempPath, ios::out | ios::trunc);
+    for(size_t i = 0; i < indices.size(); i++) {
+      file << indices[i] << "\n";
+    }
+    if (!file.good()) {
+      return false;
+    }
+  }
+
+  error_code error;
+  filesystem::rename(tempPath, filepath, error);
+  return !error;
+}
+
+
+bool VectorUtils::writeIndexSet(const string &filepath, const set<size_t> &indices) {
+  return writeIndexList(filepath, vector<size_t>(indices.begin(), indices.end()));
 }
\ No newline at end of file
@@ -5,16 +5,35 @@ printf "Experimental Approach," >> $FILEPATH
 printf "Database Size (vectors)," >> $FILEPATH
 printf "Query Encryption (seconds)," >> $FILEPATH
 printf "Query Size (ciphertexts)," >> $FILEPATH
+printf "Query Size (bytes)," >> $FILEPATH
 printf "Membership Computation (seconds)," >> $FILEPATH
 printf "Membership Result Size (ciphertexts)," >> $FILEPATH
+printf "Membership Result Size (bytes)," >> $FILEPATH
 printf "Membership Decryption (seconds)," >> $FILEPATH
 printf "Index Computation (seconds)," >> $FILEPATH
 printf "Index Result Size (ciphertexts)," >> $FILEPATH
+printf "Index Result Size (bytes)," >> $FILEPATH
 printf "Index Decryption (seconds)," >> $FILEPATH
 printf "Decrypted Membership Result," >> $FILEPATH
 printf "Decrypted Index Result" >> $FILEPATH
 printf "\n"  >> $FILEPATH
 
+FILEPATH="memory.csv"
+
+# print .csv header for experiment file
+printf "Experimental Approach," >> $FILEPATH
+printf "Database Size (vectors)," >> $FILEPATH
+printf "Run," >> $FILEPATH
+printf "Phase," >> $FILEPATH
+printf "Live Ciphertext (bytes)," >> $FILEPATH
+printf "Peak Ciphertext (bytes)," >> $FILEPATH
+printf "Live Plaintext (bytes)," >> $FILEPATH
+printf "Peak Plaintext (bytes)," >> $FILEPATH
+printf "Key Material (bytes)," >> $FILEPATH
+printf "Resident Set (bytes)," >> $FILEPATH
+printf "Peak Resident Set (bytes)" >> $FILEPATH
+printf "\n"  >> $FILEPATH
+
 FILEPATH="accuracy.csv"
 
 # print .csv header for experiment file
@@ -23,5 +42,66 @@ printf "Query Subject ID," >> $FILEPATH
 printf "True Positives," >> $FILEPATH
 printf "False Negatives," >> $FILEPATH
 printf "True Negatives," >> $FILEPATH
-printf "False Positives" >> $FILEPATH
-printf "\n"  >> $FILEPATH
\ No newline at end of file
+printf "False Positives," >> $FILEPATH
+printf "Decision" >> $FILEPATH
+printf "\n"  >> $FILEPATH
+
+FILEPATH="roc.csv"
+
+# print .csv header for threshold sweep file
+printf "Experimental Approach," >> $FILEPATH
+printf "Threshold," >> $FILEPATH
+printf "Encrypted TPR," >> $FILEPATH
+printf "Encrypted FPR," >> $FILEPATH
+printf "Encrypted FNR," >> $FILEPATH
+printf "Plaintext TPR," >> $FILEPATH
+printf "Plaintext FPR," >> $FILEPATH
+printf "Plaintext FNR" >> $FILEPATH
+printf "\n"  >> $FILEPATH
+
+FILEPATH="wrapper_bench.csv"
+
+# print .csv header for benchmark file
+printf "Primitive," >> $FILEPATH
+printf "Batch Size (slots)," >> $FILEPATH
+printf "Dimension," >> $FILEPATH
+printf "Depth," >> $FILEPATH
+printf "Threads," >> $FILEPATH
+printf "Repetitions," >> $FILEPATH
+printf "Median Time (seconds)," >> $FILEPATH
+printf "Min Time (seconds)," >> $FILEPATH
+printf "Max Error," >> $FILEPATH
+printf "Result" >> $FILEPATH
+printf "\n"  >> $FILEPATH
+
+FILEPATH="shard.csv"
+
+# print .csv header for sharded experiment file
+printf "Experimental Approach," >> $FILEPATH
+printf "Database Size (vectors)," >> $FILEPATH
+printf "Shards," >> $FILEPATH
+printf "Query Encryption (seconds)," >> $FILEPATH
+printf "Sharded Computation (seconds)," >> $FILEPATH
+printf "Combination (seconds)," >> $FILEPATH
+printf "Decryption (seconds)," >> $FILEPATH
+printf "Decrypted Membership Result," >> $FILEPATH
+printf "Decrypted Index Result" >> $FILEPATH
+printf "\n"  >> $FILEPATH
+
+FILEPATH="loadgen.csv"
+
+# print .csv header for load generator file
+printf "Experimental Approach," >> $FILEPATH
+printf "Database Size (vectors)," >> $FILEPATH
+printf "Engine," >> $FILEPATH
+printf "Mode," >> $FILEPATH
+printf "Load (clients or queries/second)," >> $FILEPATH
+printf "Window," >> $FILEPATH
+printf "Window End (seconds)," >> $FILEPATH
+printf "Completed Queries," >> $FILEPATH
+printf "Rejected Queries," >> $FILEPATH
+printf "Throughput (queries/second)," >> $FILEPATH
+printf "Median Latency (seconds)," >> $FILEPATH
+printf "95th Percentile Latency (seconds)," >> $FILEPATH
+printf "99th Percentile Latency (seconds)" >> $FILEPATH
+printf "\n"  >> $FILEPATH